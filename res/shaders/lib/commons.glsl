@@ -1,11 +1,15 @@
 // Example of a GLSL library
 
-vec4 decompress_light(float compressed_light) {
+vec4 decompress_light(uint compressed) {
 	vec4 result;
-    int compressed = floatBitsToInt(compressed_light);
-    result.r = ((compressed >> 24) & 0xFF) / 255.f;
-    result.g = ((compressed >> 16) & 0xFF) / 255.f;
-    result.b = ((compressed >> 8) & 0xFF) / 255.f;
-    result.a = (compressed & 0xFF) / 255.f;
+    result.r = float((compressed >> 24) & 0xFFu) / 255.f;
+    result.g = float((compressed >> 16) & 0xFFu) / 255.f;
+    result.b = float((compressed >> 8) & 0xFFu) / 255.f;
+    result.a = float(compressed & 0xFFu) / 255.f;
 	return result;
 }
+
+// 16 bit unorm stored as two bytes of texel (low byte first)
+float decompress_unorm16(float lo, float hi) {
+	return (round(lo * 255.0) + round(hi * 255.0) * 256.0) / 65535.0;
+}
@@ -0,0 +1,42 @@
+#ifndef BENCHMARKS_BENCH_UTIL_H_
+#define BENCHMARKS_BENCH_UTIL_H_
+
+#include <string>
+#include <iomanip>
+#include <iostream>
+#include "../typedefs.h"
+
+/* Helpers shared by benchmarks implementations */
+namespace benchmarks {
+    const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    inline uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+        const ubyte* bytes = (const ubyte*)data;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    /* Deterministic hash of integer coordinates for synthetic layouts */
+    inline uint32_t hash3(int x, int y, int z) {
+        uint32_t h = x * 73856093U ^ y * 19349663U ^ z * 83492791U;
+        h ^= h >> 13;
+        h *= 0x5bd1e995U;
+        return h ^ (h >> 15);
+    }
+
+    /* Print hash with golden value comparison result
+       @return true if hash matches golden value */
+    inline bool check_hash(const std::string& name, uint64_t hash, uint64_t golden) {
+        bool match = hash == golden;
+        std::cout << name << ": " << std::hex;
+        std::cout << "0x" << std::setw(16) << std::setfill('0') << hash;
+        std::cout << std::dec << std::setfill(' ');
+        std::cout << (match ? " OK" : " MISMATCH") << std::endl;
+        return match;
+    }
+}
+
+#endif // BENCHMARKS_BENCH_UTIL_H_
@@ -0,0 +1,45 @@
+#ifndef BENCHMARKS_BENCHMARKS_H_
+#define BENCHMARKS_BENCHMARKS_H_
+
+#include <string>
+#include "../typedefs.h"
+
+class Content;
+
+/* Headless benchmarks and regression checks (see --bench) */
+namespace benchmarks {
+    /* Generate fixed chunks grid for a set of seeds, compare voxels hashes
+       with golden values and report generation phases timings.
+       Hashes use block names, so they do not depend on content indices.
+       @return false if any hash does not match golden value */
+    bool generator(const Content* content);
+
+    /* Flood lamps light, remove it and flood sky light with LightSolver
+       in synthetic chunks layout, report solver throughput.
+       @return false if any lightmaps hash does not match golden value */
+    bool lightsolver(const Content* content);
+
+    /* Run Lighting on synthetic layouts (caves, lamps grid, overhangs):
+       chunks loading, parallel chunks lighting and blocks edits,
+       compare results with reference flood fill and report timings.
+       @return false if lightmaps do not match reference */
+    bool lighting(const Content* content);
+
+    /* Mesh generated terrain and synthetic layouts (flat, noisy,
+       checkerboard, custom models) taken from a headless ChunksStorage
+       with per-face and greedy meshing, report chunks per second,
+       vertices and bytes per chunk of both.
+       @return false if merged quads do not cover the same faces */
+    bool meshing(const Content* content);
+
+    /* Build sections faces connectivity of generated terrain and synthetic
+       layouts (caves, hollow floors), compare it with reference flood fill
+       from each face, collect visible sections from several cameras and
+       report culled sections and timings. Rays are cast from the camera
+       through not opaque voxels to check culling is conservative.
+       @return false if connectivity does not match reference or a ray
+       reaches a culled section */
+    bool culling(const Content* content);
+}
+
+#endif // BENCHMARKS_BENCHMARKS_H_
@@ -0,0 +1,306 @@
+#include "benchmarks.h"
+#include "bench_util.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <iostream>
+
+#include "../content/Content.h"
+#include "../voxels/Block.h"
+#include "../voxels/Chunk.h"
+#include "../voxels/Chunks.h"
+#include "../voxels/ChunksStorage.h"
+#include "../voxels/VoxelsVolume.h"
+#include "../voxels/WorldGenerator.h"
+#include "../graphics/ChunksRenderer.h"
+#include "../graphics/VisibilityGraph.h"
+#include "../maths/voxmaths.h"
+#include "../util/timeutil.h"
+#include "../constants.h"
+
+using namespace benchmarks;
+
+const int CULLBENCH_SIZE = 8; // chunks matrix width and depth
+const int CULLBENCH_RAYS = 20000;
+const int CULLBENCH_RAY_LENGTH = CULLBENCH_SIZE * CHUNK_W;
+const uint64_t CULLBENCH_SEED = 42;
+
+struct cullbench_blocks {
+    blockid_t stone;
+    blockid_t glass;
+};
+
+struct cullbench_layout {
+    const char* name;
+    /* @return 0 to generate terrain with WorldGenerator */
+    blockid_t (*block)(int x, int y, int z, const cullbench_blocks& blocks);
+    /* camera voxel */
+    int cameraX, cameraY, cameraZ;
+};
+
+/* Solid ground with blocky caves, glass windows and a shaft
+   to the surface in the middle */
+static blockid_t layout_caves(int x, int y, int z, const cullbench_blocks& blocks) {
+    if (y >= 100) {
+        return BLOCK_AIR;
+    }
+    if (y == 0) {
+        return blocks.stone;
+    }
+    if (x / 4 == 16 && z / 4 == 16 && y > 40) {
+        return BLOCK_AIR;
+    }
+    uint32_t h = hash3(x / 6, y / 6, z / 6);
+    if (h % 5 == 0) {
+        return BLOCK_AIR;
+    }
+    if (h % 11 == 0) {
+        return blocks.glass;
+    }
+    return blocks.stone;
+}
+
+/* Hollow floors separated by solid slabs */
+static blockid_t layout_floors(int x, int y, int z, const cullbench_blocks& blocks) {
+    if (y < 4 || y % 32 < 3) {
+        return blocks.stone;
+    }
+    if (y < 200 && x % 12 == 0 && z % 12 == 0) {
+        return blocks.stone;
+    }
+    return BLOCK_AIR;
+}
+
+static const cullbench_layout CULLBENCH_LAYOUTS[] {
+    {"surface", nullptr, 64, 120, 64},
+    {"cave", layout_caves, 66, 60, 66},
+    {"cave shaft", layout_caves, 66, 90, 66},
+    {"floors", layout_floors, 60, 70, 60},
+};
+
+/* Reference connectivity by flood fill from each face separately
+   @param open section voxels are indexed as (y * CHUNK_D + z) * CHUNK_W + x */
+static faces_connectivity reference_connectivity(const std::vector<bool>& open, int height) {
+    const int size[3] {CHUNK_W, height, CHUNK_D};
+    auto faces_of = [&size](int x, int y, int z) {
+        int coord[3] {x, y, z};
+        uint faces = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            if (coord[axis] == size[axis] - 1) faces |= 1 << (axis * 2);
+            if (coord[axis] == 0) faces |= 1 << (axis * 2 + 1);
+        }
+        return faces;
+    };
+    faces_connectivity connectivity = CONNECTED_NONE;
+    for (int face = 0; face < SECTION_FACES; face++) {
+        std::vector<bool> reached(open.size());
+        std::vector<int> stack;
+        for (int y = 0; y < height; y++) {
+            for (int z = 0; z < CHUNK_D; z++) {
+                for (int x = 0; x < CHUNK_W; x++) {
+                    int index = (y * CHUNK_D + z) * CHUNK_W + x;
+                    if (open[index] && (faces_of(x, y, z) & (1 << face))) {
+                        reached[index] = true;
+                        stack.push_back(index);
+                    }
+                }
+            }
+        }
+        uint faces = 0;
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            int x = index % CHUNK_W;
+            int z = index / CHUNK_W % CHUNK_D;
+            int y = index / (CHUNK_W * CHUNK_D);
+            faces |= faces_of(x, y, z);
+            const int neighbours[6][3] {
+                {x+1, y, z}, {x-1, y, z}, {x, y+1, z}, {x, y-1, z}, {x, y, z+1}, {x, y, z-1}
+            };
+            for (const auto& n : neighbours) {
+                if (n[0] < 0 || n[1] < 0 || n[2] < 0 ||
+                    n[0] >= CHUNK_W || n[1] >= height || n[2] >= CHUNK_D) {
+                    continue;
+                }
+                int next = (n[1] * CHUNK_D + n[2]) * CHUNK_W + n[0];
+                if (open[next] && !reached[next]) {
+                    reached[next] = true;
+                    stack.push_back(next);
+                }
+            }
+        }
+        connectivity |= (faces_connectivity)faces << (face * SECTION_FACES);
+    }
+    return connectivity;
+}
+
+static bool is_opaque(Chunks* chunks, const Content* content, int x, int y, int z) {
+    const voxel* vox = chunks->get(x, y, z);
+    if (vox == nullptr) {
+        return false;
+    }
+    const Block* def = content->getIndices()->getBlockDef(vox->id);
+    return def->rt.solid && !def->lightPassing;
+}
+
+/* Walk rays from the camera through voxels until the first opaque one,
+   sections of all passed voxels must be visible
+   @return number of voxels in culled sections */
+static size_t verify_rays(Chunks* chunks, const Content* content,
+                          const VisibilityGraph& graph, glm::vec3 camera) {
+    size_t missed = 0;
+    for (int i = 0; i < CULLBENCH_RAYS; i++) {
+        // deterministic directions uniformly distributed on sphere
+        float u = hash3(i, 1, 2) / 4294967296.0f * 2.0f - 1.0f;
+        float phi = hash3(i, 3, 4) / 4294967296.0f * 6.2831853f;
+        float r = std::sqrt(1.0f - u * u);
+        glm::vec3 dir(r * std::cos(phi), u, r * std::sin(phi));
+
+        glm::ivec3 voxel = glm::floor(camera);
+        glm::ivec3 step(dir.x > 0 ? 1 : -1, dir.y > 0 ? 1 : -1, dir.z > 0 ? 1 : -1);
+        glm::vec3 delta = glm::abs(1.0f / dir);
+        glm::vec3 next;
+        for (int axis = 0; axis < 3; axis++) {
+            float border = step[axis] > 0 ? voxel[axis] + 1 - camera[axis] : camera[axis] - voxel[axis];
+            next[axis] = border * delta[axis];
+        }
+        for (int n = 0; n < CULLBENCH_RAY_LENGTH * 3; n++) {
+            if (voxel.y < 0 || voxel.y >= CHUNK_H || chunks->get(voxel.x, voxel.y, voxel.z) == nullptr) {
+                break;
+            }
+            int sx = floordiv(voxel.x, CHUNK_W);
+            int sy = floordiv(voxel.y, MESH_SECTION_H);
+            int sz = floordiv(voxel.z, CHUNK_D);
+            if (!graph.isVisible(sx, sy, sz)) {
+                if (missed == 0) {
+                    std::cout << "  first culled visible voxel " << voxel.x << " ";
+                    std::cout << voxel.y << " " << voxel.z << std::endl;
+                }
+                missed++;
+                break;
+            }
+            if (is_opaque(chunks, content, voxel.x, voxel.y, voxel.z)) {
+                break;
+            }
+            int axis = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+            voxel[axis] += step[axis];
+            next[axis] += delta[axis];
+        }
+    }
+    return missed;
+}
+
+bool benchmarks::culling(const Content* content) {
+    cullbench_blocks blocks;
+    blocks.stone = content->requireBlock("base:stone")->rt.id;
+    blocks.glass = content->requireBlock("base:glass")->rt.id;
+
+    const int size = CULLBENCH_SIZE;
+    WorldGenerator generator(content);
+    SectionConnectivity builder(content);
+    bool success = true;
+    for (const auto& layout : CULLBENCH_LAYOUTS) {
+        std::cout << "layout " << layout.name << std::endl;
+        Chunks chunks(size, size, 0, 0, nullptr, nullptr, content);
+        ChunksStorage storage(content);
+        for (int cz = 0; cz < size; cz++) {
+            for (int cx = 0; cx < size; cx++) {
+                auto chunk = std::make_shared<Chunk>(cx, cz);
+                if (layout.block == nullptr) {
+                    generator.generate(chunk->voxels, cx, cz, CULLBENCH_SEED);
+                } else {
+                    for (int y = 0; y < CHUNK_H; y++) {
+                        for (int z = 0; z < CHUNK_D; z++) {
+                            for (int x = 0; x < CHUNK_W; x++) {
+                                voxel& vox = chunk->voxels[vox_index(x, y, z)];
+                                vox.id = layout.block(cx*CHUNK_W+x, y, cz*CHUNK_D+z, blocks);
+                                vox.states = 0;
+                            }
+                        }
+                    }
+                }
+                chunk->updateHeights();
+                chunks.putChunk(chunk);
+                storage.store(chunk);
+            }
+        }
+
+        VisibilityGraph graph;
+        graph.reset(size, MESH_SECTIONS, size, 0, 0);
+        VoxelsVolume volume(CHUNK_W + 2, CHUNK_H, CHUNK_D + 2);
+        size_t mismatches = 0;
+        size_t drawable = 0;
+        int64_t buildMcs = 0;
+        for (int cz = 0; cz < size; cz++) {
+            for (int cx = 0; cx < size; cx++) {
+                Chunk* chunk = chunks.getChunk(cx, cz);
+                volume.setPosition(cx * CHUNK_W - 1, 0, cz * CHUNK_D - 1);
+                storage.getVoxels(&volume);
+                for (int section = 0; section < MESH_SECTIONS; section++) {
+                    int y1 = section * MESH_SECTION_H;
+                    int y2 = y1 + MESH_SECTION_H;
+                    drawable += y1 < chunk->top && y2 > chunk->bottom;
+
+                    timeutil::Timer timer;
+                    faces_connectivity connectivity = builder.build(
+                        &volume, y1, y2, chunk->bottom, chunk->top);
+                    buildMcs += timer.stop();
+                    graph.set(cx, section, cz, connectivity);
+
+                    std::vector<bool> open(CHUNK_W * CHUNK_D * MESH_SECTION_H);
+                    for (size_t i = 0; i < open.size(); i++) {
+                        int x = i % CHUNK_W;
+                        int z = i / CHUNK_W % CHUNK_D;
+                        int y = y1 + i / (CHUNK_W * CHUNK_D);
+                        open[i] = !is_opaque(&chunks, content, cx*CHUNK_W+x, y, cz*CHUNK_D+z);
+                    }
+                    if (connectivity != reference_connectivity(open, MESH_SECTION_H)) {
+                        if (mismatches == 0) {
+                            std::cout << "  first connectivity mismatch in section ";
+                            std::cout << cx << " " << section << " " << cz << std::endl;
+                        }
+                        mismatches++;
+                    }
+                }
+            }
+        }
+        std::cout << "  connectivity: " << (mismatches ? "MISMATCH" : "OK");
+        std::cout << ", " << buildMcs / (size * size) << " mcs per chunk" << std::endl;
+        success &= mismatches == 0;
+
+        glm::vec3 camera(layout.cameraX + 0.5f, layout.cameraY + 0.5f, layout.cameraZ + 0.5f);
+        timeutil::Timer collectTimer;
+        graph.collect(
+            floordiv(layout.cameraX, CHUNK_W),
+            floordiv(layout.cameraY, MESH_SECTION_H),
+            floordiv(layout.cameraZ, CHUNK_D),
+            [](int, int, int) { return true; }
+        );
+        int64_t collectMcs = collectTimer.stop();
+        size_t visibleDrawable = 0;
+        for (int cz = 0; cz < size; cz++) {
+            for (int cx = 0; cx < size; cx++) {
+                Chunk* chunk = chunks.getChunk(cx, cz);
+                for (int section = 0; section < MESH_SECTIONS; section++) {
+                    int y1 = section * MESH_SECTION_H;
+                    int y2 = y1 + MESH_SECTION_H;
+                    visibleDrawable += graph.isVisible(cx, section, cz) &&
+                                       y1 < chunk->top && y2 > chunk->bottom;
+                }
+            }
+        }
+        std::cout << "  visible sections: " << visibleDrawable << " of " << drawable;
+        std::cout << " not empty (" << graph.countVisible() << " total), ";
+        std::cout << collectMcs << " mcs" << std::endl;
+
+        size_t missed = verify_rays(&chunks, content, graph, camera);
+        std::cout << "  rays: " << (missed ? "MISMATCH " : "OK");
+        if (missed) {
+            std::cout << missed << " rays reach culled sections";
+        }
+        std::cout << std::endl;
+        success &= missed == 0;
+    }
+    return success;
+}
@@ -0,0 +1,85 @@
+#include "benchmarks.h"
+#include "bench_util.h"
+
+#include <vector>
+#include <memory>
+#include <iostream>
+
+#include "../content/Content.h"
+#include "../voxels/Block.h"
+#include "../voxels/voxel.h"
+#include "../voxels/WorldGenerator.h"
+#include "../voxels/GeneratorStage.h"
+#include "../util/timeutil.h"
+#include "../constants.h"
+
+const int GENBENCH_GRID_FROM = -4;
+const int GENBENCH_GRID_TO = 4; // exclusive
+
+struct genbench_case {
+    uint64_t seed;
+    uint64_t golden;
+};
+
+/* Golden hashes of the grid generated with base content pack.
+   Update only if terrain change is intended. */
+static const genbench_case GENBENCH_CASES[] {
+    {0, 0xbe26916e15ff9bd2ULL},
+    {1, 0x9454e7111ed31eedULL},
+    {42, 0x96b6cd58264a98baULL},
+    {1337, 0x430e0076e1a714cbULL},
+    {9876543210ULL, 0xea66bb679ce88ccdULL},
+};
+
+using namespace benchmarks;
+
+bool benchmarks::generator(const Content* content) {
+    auto indices = content->getIndices();
+    // hash of block name for each index
+    std::vector<uint64_t> names(indices->countBlockDefs());
+    for (size_t i = 0; i < names.size(); i++) {
+        const std::string& name = indices->getBlockDef(i)->name;
+        names[i] = fnv1a(FNV_OFFSET, name.data(), name.length());
+    }
+
+    WorldGenerator generator(content);
+    GeneratorTimings timings;
+    std::unique_ptr<voxel[]> voxels (new voxel[CHUNK_VOL]);
+    size_t chunksCount = 0;
+    int64_t totalMcs = 0;
+    bool success = true;
+    for (const auto& testcase : GENBENCH_CASES) {
+        uint64_t hash = FNV_OFFSET;
+        for (int cz = GENBENCH_GRID_FROM; cz < GENBENCH_GRID_TO; cz++) {
+            for (int cx = GENBENCH_GRID_FROM; cx < GENBENCH_GRID_TO; cx++) {
+                timeutil::Timer timer;
+                generator.generate(voxels.get(), cx, cz, testcase.seed, &timings);
+                totalMcs += timer.stop();
+                chunksCount++;
+
+                for (size_t i = 0; i < CHUNK_VOL; i++) {
+                    const voxel& vox = voxels[i];
+                    uint64_t name = names.at(vox.id);
+                    hash = fnv1a(hash, &name, sizeof(name));
+                    hash = fnv1a(hash, &vox.states, sizeof(vox.states));
+                }
+            }
+        }
+        std::string name = "seed " + std::to_string(testcase.seed);
+        success &= check_hash(name, hash, testcase.golden);
+    }
+
+    double seconds = totalMcs / 1e6;
+    std::cout << "chunks: " << chunksCount << ", ";
+    std::cout << chunksCount / seconds << " chunks/s" << std::endl;
+    std::cout << "maps: " << timings.maps / chunksCount << " mcs/chunk" << std::endl;
+    const auto& stages = generator.getStages();
+    for (size_t i = 0; i < stages.size(); i++) {
+        std::cout << stages[i]->getName() << ": ";
+        std::cout << timings.stages[i] / chunksCount << " mcs/chunk" << std::endl;
+    }
+    if (!success) {
+        std::cout << "generator output does not match golden hashes" << std::endl;
+    }
+    return success;
+}
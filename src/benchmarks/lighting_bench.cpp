@@ -0,0 +1,338 @@
+#include "benchmarks.h"
+#include "bench_util.h"
+
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+#include "../content/Content.h"
+#include "../voxels/Block.h"
+#include "../voxels/Chunk.h"
+#include "../voxels/Chunks.h"
+#include "../voxels/voxel.h"
+#include "../lighting/Lighting.h"
+#include "../lighting/Lightmap.h"
+#include "../world/LevelEvents.h"
+#include "../util/timeutil.h"
+#include "../constants.h"
+
+using namespace benchmarks;
+
+const int LIGHTINGBENCH_SIZE = 4; // chunks matrix width and depth
+const int LIGHTINGBENCH_THREADS = 4;
+const int LIGHTINGBENCH_EDITS = 400;
+
+/* Blocks used by layouts */
+struct lightbench_blocks {
+    blockid_t solid;
+    blockid_t lamps[4];
+};
+
+struct lightbench_layout {
+    const char* name;
+    blockid_t (*block)(int x, int y, int z, const lightbench_blocks& blocks);
+};
+
+/* Solid ground with blocky caves, shafts open to the sky
+   and scarce lamps inside */
+static blockid_t layout_caves(int x, int y, int z, const lightbench_blocks& blocks) {
+    if (y >= 72) {
+        return BLOCK_AIR;
+    }
+    if (y == 0) {
+        return blocks.solid;
+    }
+    if (x % 23 == 5 && z % 19 == 7) {
+        return BLOCK_AIR;
+    }
+    if (hash3(x / 4, y / 4, z / 4) % 3 == 0) {
+        uint32_t h = hash3(x, y, z);
+        if (h % 97 == 0) {
+            return blocks.lamps[h / 97 % 4];
+        }
+        return BLOCK_AIR;
+    }
+    return blocks.solid;
+}
+
+/* Floor with pillars and lamps grid on several levels */
+static blockid_t layout_lamps(int x, int y, int z, const lightbench_blocks& blocks) {
+    if (y < 8 || (x % 6 == 2 && z % 6 == 2)) {
+        return blocks.solid;
+    }
+    if (y % 16 == 12 && x % 8 == 4 && z % 8 == 4) {
+        return blocks.lamps[(x / 8 + z / 8 + y / 16) % 4];
+    }
+    return BLOCK_AIR;
+}
+
+/* Terraces with checkered slabs and thin roofs making deep shadows */
+static blockid_t layout_overhangs(int x, int y, int z, const lightbench_blocks& blocks) {
+    if (y < 16 + (x / 16) * 4) {
+        return blocks.solid;
+    }
+    if (y % 24 == 20 && (x / 8 + z / 8) % 2 == 0) {
+        return blocks.solid;
+    }
+    if (y == 100 && x % 3 != 0) {
+        return blocks.solid;
+    }
+    if (y == 30 && x % 11 == 5 && z % 13 == 6) {
+        return blocks.lamps[(x + z) % 4];
+    }
+    return BLOCK_AIR;
+}
+
+static const lightbench_layout LIGHTINGBENCH_LAYOUTS[] {
+    {"caves", layout_caves},
+    {"lamps", layout_lamps},
+    {"overhangs", layout_overhangs},
+};
+
+static void clear_lights(Chunks* chunks) {
+    for (size_t i = 0; i < chunks->volume; i++) {
+        light_t* lights = chunks->chunks[i]->lightmap->getLightsWriteable();
+        std::memset(lights, 0, CHUNK_VOL * sizeof(light_t));
+    }
+}
+
+static uint64_t hash_lights(Chunks* chunks) {
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < chunks->volume; i++) {
+        const light_t* lights = chunks->chunks[i]->lightmap->getLights();
+        hash = fnv1a(hash, lights, CHUNK_VOL * sizeof(light_t));
+    }
+    return hash;
+}
+
+/* Reference lighting calculated from scratch by plain flood fill
+   of each channel, independent from LightSolver implementation.
+   Voxels are indexed as ((y * depth) + z) * width + x */
+static std::vector<light_t> reference_lights(Chunks* chunks, const Content* content) {
+    const Block* const* blockDefs = content->getIndices()->getBlockDefs();
+    const int width = chunks->w * CHUNK_W;
+    const int depth = chunks->d * CHUNK_D;
+    const size_t volume = (size_t)width * depth * CHUNK_H;
+    const int gx = chunks->ox * CHUNK_W;
+    const int gz = chunks->oz * CHUNK_D;
+
+    std::vector<const Block*> defs(volume);
+    for (int y = 0; y < CHUNK_H; y++) {
+        for (int z = 0; z < depth; z++) {
+            for (int x = 0; x < width; x++) {
+                defs[((size_t)y * depth + z) * width + x] = blockDefs[chunks->get(gx+x, y, gz+z)->id];
+            }
+        }
+    }
+
+    std::vector<light_t> lights(volume, 0);
+    for (int channel = 0; channel < 4; channel++) {
+        const int shift = channel * 4;
+        // voxels indices by light level
+        std::vector<size_t> levels[16];
+        auto set = [&](size_t index, int light) {
+            lights[index] = (lights[index] & ~(0xF << shift)) | (light << shift);
+            levels[light].push_back(index);
+        };
+        if (channel < 3) {
+            for (size_t i = 0; i < volume; i++) {
+                int emission = defs[i]->emission[channel];
+                if (emission > 1) {
+                    set(i, emission);
+                }
+            }
+        } else {
+            for (int z = 0; z < depth; z++) {
+                for (int x = 0; x < width; x++) {
+                    for (int y = CHUNK_H-1; y >= 0; y--) {
+                        size_t index = ((size_t)y * depth + z) * width + x;
+                        if (!defs[index]->skyLightPassing)
+                            break;
+                        set(index, 15);
+                    }
+                }
+            }
+        }
+        for (int light = 15; light > 1; light--) {
+            for (size_t n = 0; n < levels[light].size(); n++) {
+                size_t index = levels[light][n];
+                if (((lights[index] >> shift) & 0xF) != light)
+                    continue;
+                int x = index % width;
+                int z = index / width % depth;
+                int y = index / width / depth;
+                const int neighbours[6][3] {
+                    {x+1, y, z}, {x-1, y, z}, {x, y+1, z},
+                    {x, y-1, z}, {x, y, z+1}, {x, y, z-1}
+                };
+                for (const auto& pos : neighbours) {
+                    if (pos[0] < 0 || pos[1] < 0 || pos[2] < 0 ||
+                        pos[0] >= width || pos[1] >= CHUNK_H || pos[2] >= depth)
+                        continue;
+                    size_t nindex = ((size_t)pos[1] * depth + pos[2]) * width + pos[0];
+                    if (!defs[nindex]->lightPassing)
+                        continue;
+                    if (((lights[nindex] >> shift) & 0xF) < light-1) {
+                        set(nindex, light-1);
+                    }
+                }
+            }
+        }
+    }
+    return lights;
+}
+
+/* Compare chunks lightmaps with reference lighting
+   @return count of mismatching voxels */
+static size_t verify_lights(Chunks* chunks, const Content* content) {
+    std::vector<light_t> reference = reference_lights(chunks, content);
+    const int width = chunks->w * CHUNK_W;
+    const int depth = chunks->d * CHUNK_D;
+    size_t mismatches = 0;
+    for (int y = 0; y < CHUNK_H; y++) {
+        for (int z = 0; z < depth; z++) {
+            for (int x = 0; x < width; x++) {
+                light_t expected = reference[((size_t)y * depth + z) * width + x];
+                light_t light = chunks->getLight(chunks->ox*CHUNK_W+x, y, chunks->oz*CHUNK_D+z);
+                if (light == expected)
+                    continue;
+                if (mismatches == 0) {
+                    std::cout << "  first mismatch at " << x << " " << y << " " << z;
+                    std::cout << std::hex << ": 0x" << light;
+                    std::cout << " expected 0x" << expected << std::dec << std::endl;
+                }
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+static bool check_lights(const std::string& name, Chunks* chunks, const Content* content) {
+    size_t mismatches = verify_lights(chunks, content);
+    std::cout << name << ": " << (mismatches ? "MISMATCH " : "OK");
+    if (mismatches) {
+        std::cout << mismatches << " voxels";
+    }
+    std::cout << std::endl;
+    return mismatches == 0;
+}
+
+/* Deterministic blocks edits: digging, solid blocks and lamps placement */
+static void edit_blocks(Chunks* chunks, Lighting* lighting,
+                        const lightbench_blocks& blocks, uint32_t seed) {
+    const int width = chunks->w * CHUNK_W;
+    const int depth = chunks->d * CHUNK_D;
+    for (int i = 0; i < LIGHTINGBENCH_EDITS; i++) {
+        uint32_t h = hash3(i, seed, 7);
+        int x = chunks->ox * CHUNK_W + h % width;
+        int z = chunks->oz * CHUNK_D + (h >> 8) % depth;
+        int y = 1 + (h >> 16) % 110;
+        blockid_t id;
+        switch (hash3(seed, i, 13) % 4) {
+            case 0: id = blocks.solid; break;
+            case 1: id = blocks.lamps[h % 4]; break;
+            default: id = BLOCK_AIR; break;
+        }
+        if (chunks->get(x, y, z)->id == id)
+            continue;
+        chunks->set(x, y, z, id, 0);
+        lighting->onBlockSet(x, y, z, id);
+    }
+}
+
+bool benchmarks::lighting(const Content* content) {
+    lightbench_blocks blocks;
+    blocks.solid = content->requireBlock("base:stone")->rt.id;
+    blocks.lamps[0] = content->requireBlock("base:lamp")->rt.id;
+    blocks.lamps[1] = content->requireBlock("base:red_lamp")->rt.id;
+    blocks.lamps[2] = content->requireBlock("base:green_lamp")->rt.id;
+    blocks.lamps[3] = content->requireBlock("base:blue_lamp")->rt.id;
+
+    const int size = LIGHTINGBENCH_SIZE;
+    bool success = true;
+    for (const auto& layout : LIGHTINGBENCH_LAYOUTS) {
+        std::cout << "layout " << layout.name << std::endl;
+        LevelEvents events;
+        Chunks chunks(size, size, 0, 0, nullptr, &events, content);
+        std::vector<std::shared_ptr<Chunk>> batch;
+        for (int cz = 0; cz < size; cz++) {
+            for (int cx = 0; cx < size; cx++) {
+                auto chunk = std::make_shared<Chunk>(cx, cz);
+                for (int y = 0; y < CHUNK_H; y++) {
+                    for (int z = 0; z < CHUNK_D; z++) {
+                        for (int x = 0; x < CHUNK_W; x++) {
+                            voxel& vox = chunk->voxels[vox_index(x, y, z)];
+                            vox.id = layout.block(cx*CHUNK_W+x, y, cz*CHUNK_D+z, blocks);
+                            vox.states = 0;
+                        }
+                    }
+                }
+                chunk->updateHeights();
+                chunks.putChunk(chunk);
+                batch.push_back(chunk);
+            }
+        }
+        Lighting lighting(content, &chunks);
+
+        timeutil::Timer skyTimer;
+        for (int cz = 0; cz < size; cz++) {
+            for (int cx = 0; cx < size; cx++) {
+                lighting.prebuildSkyLight(cx, cz);
+            }
+        }
+        for (int cz = 0; cz < size; cz++) {
+            for (int cx = 0; cx < size; cx++) {
+                lighting.buildSkyLight(cx, cz);
+            }
+        }
+        int64_t skyMcs = skyTimer.stop();
+
+        timeutil::Timer loadedTimer;
+        for (int cz = 0; cz < size; cz++) {
+            for (int cx = 0; cx < size; cx++) {
+                lighting.onChunkLoaded(cx, cz);
+            }
+        }
+        int64_t loadedMcs = loadedTimer.stop();
+        success &= check_lights("  chunks", &chunks, content);
+        uint64_t serialHash = hash_lights(&chunks);
+
+        clear_lights(&chunks);
+        timeutil::Timer parallelTimer;
+        for (int cz = 0; cz < size; cz++) {
+            for (int cx = 0; cx < size; cx++) {
+                lighting.prebuildSkyLight(cx, cz);
+            }
+        }
+        lighting.buildChunks(batch, LIGHTINGBENCH_THREADS);
+        int64_t parallelMcs = parallelTimer.stop();
+        success &= check_hash("  parallel", hash_lights(&chunks), serialHash);
+
+        timeutil::Timer editsTimer;
+        edit_blocks(&chunks, &lighting, blocks, 1);
+        int64_t editsMcs = editsTimer.stop();
+        success &= check_lights("  block set", &chunks, content);
+
+        timeutil::Timer transactionTimer;
+        lighting.beginTransaction();
+        edit_blocks(&chunks, &lighting, blocks, 2);
+        lighting.endTransaction();
+        int64_t transactionMcs = transactionTimer.stop();
+        success &= check_lights("  transaction", &chunks, content);
+
+        std::cout << "  sky light: " << skyMcs << " mcs" << std::endl;
+        std::cout << "  chunks loaded: " << loadedMcs << " mcs" << std::endl;
+        std::cout << "  parallel (" << LIGHTINGBENCH_THREADS << " threads): ";
+        std::cout << parallelMcs << " mcs" << std::endl;
+        std::cout << "  block set: " << editsMcs / LIGHTINGBENCH_EDITS;
+        std::cout << " mcs per block" << std::endl;
+        std::cout << "  transaction: " << transactionMcs / LIGHTINGBENCH_EDITS;
+        std::cout << " mcs per block" << std::endl;
+    }
+    if (!success) {
+        std::cout << "lighting does not match reference flood fill" << std::endl;
+    }
+    return success;
+}
@@ -0,0 +1,225 @@
+#include "benchmarks.h"
+#include "bench_util.h"
+
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+#include "../content/Content.h"
+#include "../voxels/Block.h"
+#include "../voxels/Chunk.h"
+#include "../voxels/Chunks.h"
+#include "../voxels/voxel.h"
+#include "../lighting/Lightmap.h"
+#include "../lighting/LightSolver.h"
+#include "../lighting/RGBLightSolver.h"
+#include "../world/LevelEvents.h"
+#include "../util/timeutil.h"
+#include "../constants.h"
+
+using namespace benchmarks;
+
+const int LIGHTBENCH_SIZE = 4; // chunks matrix width and depth
+const int LIGHTBENCH_ROUNDS = 5;
+const int LIGHTBENCH_LAMPS_STEP = 8;
+
+/* Golden hashes of lightmaps after each phase.
+   Update only if solver behaviour change is intended. */
+const uint64_t LIGHTBENCH_GOLDEN_LAMPS = 0x9d074c05c1510ba6ULL;
+const uint64_t LIGHTBENCH_GOLDEN_REMOVE = 0x7ab6a128b6a22325ULL;
+const uint64_t LIGHTBENCH_GOLDEN_SKY = 0x51f234bcd45789d5ULL;
+
+/* Floor, pillars grid and checkered slabs making overhangs */
+static blockid_t layout_block(int x, int y, int z, blockid_t solid) {
+    if (y < 8 || (x % 6 == 2 && z % 6 == 2)) {
+        return solid;
+    }
+    if (y % 32 == 16 && (x / 8 + z / 8) % 2 == 0) {
+        return solid;
+    }
+    return BLOCK_AIR;
+}
+
+static uint64_t hash_lights(Chunks* chunks) {
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < chunks->volume; i++) {
+        const light_t* lights = chunks->chunks[i]->lightmap->getLights();
+        hash = fnv1a(hash, lights, CHUNK_VOL * sizeof(light_t));
+    }
+    return hash;
+}
+
+/* @return count of voxels with non-zero light in the channel */
+static size_t count_lit(Chunks* chunks, int channel) {
+    size_t count = 0;
+    for (size_t i = 0; i < chunks->volume; i++) {
+        const light_t* lights = chunks->chunks[i]->lightmap->getLights();
+        for (size_t j = 0; j < CHUNK_VOL; j++) {
+            count += Lightmap::extract(lights[j], channel) != 0;
+        }
+    }
+    return count;
+}
+
+static void clear_lights(Chunks* chunks) {
+    for (size_t i = 0; i < chunks->volume; i++) {
+        light_t* lights = chunks->chunks[i]->lightmap->getLightsWriteable();
+        std::memset(lights, 0, CHUNK_VOL * sizeof(light_t));
+    }
+}
+
+/* Emission of lamps similar to base content pack ones */
+static glm::ivec3 lamp_emission(size_t index) {
+    static const glm::ivec3 emissions[] {
+        {15, 14, 13}, {13, 13, 12}, {15, 0, 0}, {0, 15, 0}, {1, 9, 15}
+    };
+    return emissions[index % 5];
+}
+
+static void report(const char* phase, int64_t mcs, size_t cells) {
+    std::cout << phase << ": " << mcs / LIGHTBENCH_ROUNDS << " mcs, ";
+    std::cout << cells * LIGHTBENCH_ROUNDS / (mcs / 1e6) / 1e6;
+    std::cout << " M cells/s" << std::endl;
+}
+
+bool benchmarks::lightsolver(const Content* content) {
+    const int width = LIGHTBENCH_SIZE * CHUNK_W;
+    const int depth = LIGHTBENCH_SIZE * CHUNK_D;
+    blockid_t solid = content->requireBlock("base:stone")->rt.id;
+
+    LevelEvents events;
+    Chunks chunks(LIGHTBENCH_SIZE, LIGHTBENCH_SIZE, 0, 0, nullptr, &events, content);
+    for (int cz = 0; cz < LIGHTBENCH_SIZE; cz++) {
+        for (int cx = 0; cx < LIGHTBENCH_SIZE; cx++) {
+            auto chunk = std::make_shared<Chunk>(cx, cz);
+            for (int y = 0; y < CHUNK_H; y++) {
+                for (int z = 0; z < CHUNK_D; z++) {
+                    for (int x = 0; x < CHUNK_W; x++) {
+                        voxel& vox = chunk->voxels[vox_index(x, y, z)];
+                        vox.id = layout_block(cx * CHUNK_W + x, y, cz * CHUNK_D + z, solid);
+                        vox.states = 0;
+                    }
+                }
+            }
+            chunks.putChunk(chunk);
+        }
+    }
+
+    std::vector<glm::ivec3> lamps;
+    for (int y = 12; y < CHUNK_H; y += 32) {
+        for (int z = 4; z < depth; z += LIGHTBENCH_LAMPS_STEP) {
+            for (int x = 4; x < width; x += LIGHTBENCH_LAMPS_STEP) {
+                lamps.push_back(glm::ivec3(x, y, z));
+            }
+        }
+    }
+
+    auto indices = content->getIndices();
+    LightSolver solverR(indices, &chunks, 0);
+    LightSolver solverS(indices, &chunks, 3);
+
+    int64_t lampsMcs = 0, removeMcs = 0, skyMcs = 0;
+    size_t lampsCells = 0, skyCells = 0;
+    uint64_t lampsHash = 0, removeHash = 0, skyHash = 0;
+    for (int round = 0; round < LIGHTBENCH_ROUNDS; round++) {
+        clear_lights(&chunks);
+
+        timeutil::Timer lampsTimer;
+        for (const auto& lamp : lamps) {
+            solverR.add(lamp.x, lamp.y, lamp.z, 15);
+        }
+        solverR.solve();
+        lampsMcs += lampsTimer.stop();
+        lampsHash = hash_lights(&chunks);
+        lampsCells = count_lit(&chunks, 0);
+
+        timeutil::Timer removeTimer;
+        for (const auto& lamp : lamps) {
+            solverR.remove(lamp.x, lamp.y, lamp.z);
+        }
+        solverR.solve();
+        removeMcs += removeTimer.stop();
+        removeHash = hash_lights(&chunks);
+
+        timeutil::Timer skyTimer;
+        for (int z = 0; z < depth; z++) {
+            for (int x = 0; x < width; x++) {
+                solverS.add(x, CHUNK_H-1, z, 15);
+            }
+        }
+        solverS.solve();
+        skyMcs += skyTimer.stop();
+        skyHash = hash_lights(&chunks);
+        skyCells = count_lit(&chunks, 3);
+    }
+
+    // colored lamps: separate channel solvers vs combined RGB solver
+    LightSolver solverG(indices, &chunks, 1);
+    LightSolver solverB(indices, &chunks, 2);
+    RGBLightSolver solverRGB(indices, &chunks);
+    int64_t separateMcs = 0, combinedMcs = 0;
+    uint64_t separateHashes[2] {}, combinedHashes[2] {};
+    size_t rgbCells = 0;
+    for (int round = 0; round < LIGHTBENCH_ROUNDS; round++) {
+        clear_lights(&chunks);
+        timeutil::Timer separateTimer;
+        for (size_t i = 0; i < lamps.size(); i++) {
+            const auto& lamp = lamps[i];
+            glm::ivec3 emission = lamp_emission(i);
+            solverR.add(lamp.x, lamp.y, lamp.z, emission.r);
+            solverG.add(lamp.x, lamp.y, lamp.z, emission.g);
+            solverB.add(lamp.x, lamp.y, lamp.z, emission.b);
+        }
+        solverR.solve();
+        solverG.solve();
+        solverB.solve();
+        separateHashes[0] = hash_lights(&chunks);
+        rgbCells = count_lit(&chunks, 0) + count_lit(&chunks, 1) + count_lit(&chunks, 2);
+        for (size_t i = 0; i < lamps.size(); i += 2) {
+            const auto& lamp = lamps[i];
+            solverR.remove(lamp.x, lamp.y, lamp.z);
+            solverG.remove(lamp.x, lamp.y, lamp.z);
+            solverB.remove(lamp.x, lamp.y, lamp.z);
+        }
+        solverR.solve();
+        solverG.solve();
+        solverB.solve();
+        separateMcs += separateTimer.stop();
+        separateHashes[1] = hash_lights(&chunks);
+
+        clear_lights(&chunks);
+        timeutil::Timer combinedTimer;
+        for (size_t i = 0; i < lamps.size(); i++) {
+            const auto& lamp = lamps[i];
+            glm::ivec3 emission = lamp_emission(i);
+            solverRGB.add(lamp.x, lamp.y, lamp.z, emission.r, emission.g, emission.b);
+        }
+        solverRGB.solve();
+        combinedHashes[0] = hash_lights(&chunks);
+        for (size_t i = 0; i < lamps.size(); i += 2) {
+            const auto& lamp = lamps[i];
+            solverRGB.remove(lamp.x, lamp.y, lamp.z);
+        }
+        solverRGB.solve();
+        combinedMcs += combinedTimer.stop();
+        combinedHashes[1] = hash_lights(&chunks);
+    }
+
+    report("lamps", lampsMcs, lampsCells);
+    report("remove", removeMcs, lampsCells);
+    report("sky", skyMcs, skyCells);
+    report("rgb separate", separateMcs, rgbCells);
+    report("rgb combined", combinedMcs, rgbCells);
+
+    bool success = true;
+    success &= check_hash("lamps", lampsHash, LIGHTBENCH_GOLDEN_LAMPS);
+    success &= check_hash("remove", removeHash, LIGHTBENCH_GOLDEN_REMOVE);
+    success &= check_hash("sky", skyHash, LIGHTBENCH_GOLDEN_SKY);
+    success &= check_hash("rgb add", combinedHashes[0], separateHashes[0]);
+    success &= check_hash("rgb remove", combinedHashes[1], separateHashes[1]);
+    if (!success) {
+        std::cout << "light solver output does not match golden hashes" << std::endl;
+    }
+    return success;
+}
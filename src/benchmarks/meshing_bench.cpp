@@ -0,0 +1,316 @@
+#include "benchmarks.h"
+#include "bench_util.h"
+
+#include <cmath>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "../content/Content.h"
+#include "../voxels/Block.h"
+#include "../voxels/Chunk.h"
+#include "../voxels/Chunks.h"
+#include "../voxels/ChunksStorage.h"
+#include "../voxels/VoxelsVolume.h"
+#include "../voxels/WorldGenerator.h"
+#include "../lighting/Lighting.h"
+#include "../graphics/MeshData.h"
+#include "../graphics/BlocksRenderer.h"
+#include "../frontend/ContentGfxCache.h"
+#include "../util/timeutil.h"
+#include "../settings.h"
+#include "../constants.h"
+
+using namespace benchmarks;
+
+const int MESHBENCH_SIZE = 5; // chunks matrix width and depth, border chunks are not meshed
+const int MESHBENCH_REPEATS = 4;
+static const uint64_t MESHBENCH_SEEDS[] {1, 42, 1337};
+
+/* Blocks used by synthetic layouts */
+struct meshbench_blocks {
+    blockid_t stone;
+    blockid_t dirt;
+    blockid_t grass;
+    blockid_t glass;
+    blockid_t leaves;
+    /* not cube shaped: X sprites and aabb models */
+    blockid_t models[4];
+};
+
+struct meshbench_layout {
+    const char* name;
+    /* @return voxel at global position */
+    voxel (*block)(int x, int y, int z, const meshbench_blocks& blocks);
+};
+
+/* Flat ground: the best case, only top faces of one layer are visible */
+static voxel layout_flat(int x, int y, int z, const meshbench_blocks& blocks) {
+    if (y < 40) {
+        return {blocks.stone, 0};
+    }
+    if (y < 44) {
+        return {blocks.dirt, 0};
+    }
+    if (y == 44) {
+        return {blocks.grass, 0};
+    }
+    return {BLOCK_AIR, 0};
+}
+
+/* Rough hills with single block steps, floating glass and leaves */
+static voxel layout_noisy(int x, int y, int z, const meshbench_blocks& blocks) {
+    int height = 60 + (int)(std::sin(x * 0.19f) * 9 + std::cos(z * 0.23f) * 9);
+    height += hash3(x, 0, z) % 3;
+    if (y < height - 4) {
+        return {blocks.stone, 0};
+    }
+    if (y < height) {
+        return {blocks.dirt, 0};
+    }
+    if (y == height) {
+        return {blocks.grass, 0};
+    }
+    if (y > 80 && y < 96 && hash3(x / 3, y / 3, z / 3) % 5 == 0) {
+        return {hash3(x, y, z) % 2 ? blocks.glass : blocks.leaves, 0};
+    }
+    return {BLOCK_AIR, 0};
+}
+
+/* 3D checkerboard: the worst case, all faces of every block are visible
+   and greedy meshing has nothing to merge */
+static voxel layout_checkerboard(int x, int y, int z, const meshbench_blocks& blocks) {
+    if (y < 64 && (x + y + z) % 2 == 0) {
+        return {blocks.stone, 0};
+    }
+    return {BLOCK_AIR, 0};
+}
+
+/* Floor covered with several layers of sprites, torches and rotated panes */
+static voxel layout_models(int x, int y, int z, const meshbench_blocks& blocks) {
+    if (y < 32) {
+        return {blocks.stone, 0};
+    }
+    if (y < 40 && (x + z) % 2 == 0) {
+        uint32_t h = hash3(x, y, z);
+        return {blocks.models[h % 4], (blockstate_t)(h / 4 % 4)};
+    }
+    if (y < 40) {
+        return {blocks.glass, 0};
+    }
+    return {BLOCK_AIR, 0};
+}
+
+static const meshbench_layout MESHBENCH_LAYOUTS[] {
+    {"flat", layout_flat},
+    {"noisy", layout_noisy},
+    {"checkerboard", layout_checkerboard},
+    {"models", layout_models},
+};
+
+struct meshbench_result {
+    size_t vertices = 0;
+    size_t indices = 0;
+    /* faces area in blocks, texture tiles are counted at the third vertex of quad */
+    double area = 0.0;
+    int64_t mcs = 0;
+};
+
+/* Chunks matrix lit by Lighting and put into headless ChunksStorage,
+   so meshes input is taken the same way ChunksRenderer does */
+class meshbench_world {
+    const Content* content;
+    Chunks chunks;
+    std::vector<std::shared_ptr<Chunk>> batch;
+public:
+    ChunksStorage storage;
+
+    meshbench_world(const Content* content)
+        : content(content),
+          chunks(MESHBENCH_SIZE, MESHBENCH_SIZE, 0, 0, nullptr, nullptr, content),
+          storage(content) {
+    }
+
+    Chunk* add(int cx, int cz) {
+        auto chunk = std::make_shared<Chunk>(cx, cz);
+        chunks.putChunk(chunk);
+        storage.store(chunk);
+        batch.push_back(chunk);
+        return chunk.get();
+    }
+
+    void light() {
+        Lighting lighting(content, &chunks);
+        for (auto& chunk : batch) {
+            chunk->updateHeights();
+            lighting.prebuildSkyLight(chunk->x, chunk->z);
+        }
+        lighting.buildChunks(batch, 1);
+    }
+};
+
+struct meshbench_input {
+    std::vector<std::unique_ptr<VoxelsVolume>> volumes;
+    std::vector<std::pair<int, int>> heights;
+    /* ChunksStorage::getVoxels time */
+    int64_t fetchMcs = 0;
+};
+
+/* Take voxels of inner chunks like ChunksRenderer mesh jobs do */
+static meshbench_input fetch_chunks(meshbench_world& world) {
+    meshbench_input input;
+    for (int cz = 1; cz < MESHBENCH_SIZE - 1; cz++) {
+        for (int cx = 1; cx < MESHBENCH_SIZE - 1; cx++) {
+            auto volume = std::make_unique<VoxelsVolume>(CHUNK_W + 2, CHUNK_H, CHUNK_D + 2);
+            volume->setPosition(cx * CHUNK_W - 1, 0, cz * CHUNK_D - 1);
+            auto chunk = world.storage.get(cx, cz);
+            timeutil::Timer timer;
+            world.storage.getVoxels(volume.get(), std::max(chunk->bottom - 1, 0),
+                                    std::min(chunk->top + 1, CHUNK_H));
+            input.fetchMcs += timer.stop();
+            input.heights.push_back({chunk->bottom, chunk->top});
+            input.volumes.push_back(std::move(volume));
+        }
+    }
+    return input;
+}
+
+static meshbench_result mesh_chunks(const meshbench_input& input, BlocksRenderer* renderer) {
+    meshbench_result result;
+    auto data = std::make_unique<MeshData>(BlocksRenderer::VERTEX_SIZE);
+    for (size_t i = 0; i < input.volumes.size(); i++) {
+        const auto& heights = input.heights[i];
+        timeutil::Timer timer;
+        for (int r = 0; r < MESHBENCH_REPEATS; r++) {
+            renderer->render(input.volumes[i].get(), heights.first, heights.second, *data);
+        }
+        result.mcs += timer.stop();
+        size_t vertices = data->getVerticesCount();
+        result.vertices += vertices;
+        result.indices += data->indicesCount;
+        for (size_t v = 2; v < vertices; v += 4) {
+            // texture coordinates packed by BlocksRenderer::packVertex
+            uint32_t packed = data->vertices[v * data->vertexSize + 1];
+            result.area += ((packed >> 14) & 0x1FF) * (packed >> 23);
+        }
+    }
+    return result;
+}
+
+static void print_result(const char* name, const meshbench_result& result, size_t chunks) {
+    size_t bytes = result.vertices * BlocksRenderer::VERTEX_SIZE * sizeof(uint32_t) +
+                   result.indices * sizeof(int);
+    int64_t mcs = std::max(result.mcs, (int64_t)1);
+    std::cout << "  " << name << ": ";
+    std::cout << result.vertices / chunks << " vertices, ";
+    std::cout << bytes / chunks << " bytes, ";
+    std::cout << result.mcs / (chunks * MESHBENCH_REPEATS) << " mcs per chunk, ";
+    std::cout << (int64_t)(chunks * MESHBENCH_REPEATS * 1000000 / mcs) << " chunks/s";
+    std::cout << std::endl;
+}
+
+/* Mesh chunks with both renderers and print results
+   @return false if merged quads do not cover the same faces */
+static bool run_meshing(const std::string& name,
+                        const meshbench_input& input,
+                        BlocksRenderer* facesRenderer,
+                        BlocksRenderer* greedyRenderer,
+                        meshbench_result& facesTotal,
+                        meshbench_result& greedyTotal) {
+    meshbench_result faces = mesh_chunks(input, facesRenderer);
+    meshbench_result greedy = mesh_chunks(input, greedyRenderer);
+    size_t count = input.volumes.size();
+    std::cout << name << std::endl;
+    std::cout << "  fetch: " << input.fetchMcs / count << " mcs per chunk" << std::endl;
+    print_result("faces", faces, count);
+    print_result("greedy", greedy, count);
+    std::cout << "  vertices ratio: " << (double)greedy.vertices / faces.vertices;
+    std::cout << std::endl;
+
+    facesTotal.vertices += faces.vertices;
+    facesTotal.indices += faces.indices;
+    facesTotal.mcs += faces.mcs;
+    greedyTotal.vertices += greedy.vertices;
+    greedyTotal.indices += greedy.indices;
+    greedyTotal.mcs += greedy.mcs;
+
+    // merged quads must cover exactly the same faces
+    if (greedy.area != faces.area) {
+        std::cout << "  faces area MISMATCH: " << greedy.area;
+        std::cout << " expected " << faces.area << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool benchmarks::meshing(const Content* content) {
+    ContentGfxCache cache(content);
+    EngineSettings facesSettings;
+    facesSettings.graphics.greedyMeshing = false;
+    EngineSettings greedySettings;
+    greedySettings.graphics.greedyMeshing = true;
+    BlocksRenderer facesRenderer(content, &cache, facesSettings);
+    BlocksRenderer greedyRenderer(content, &cache, greedySettings);
+
+    meshbench_result facesTotal;
+    meshbench_result greedyTotal;
+    size_t chunksTotal = 0;
+    bool success = true;
+
+    WorldGenerator generator(content);
+    for (uint64_t seed : MESHBENCH_SEEDS) {
+        meshbench_world world(content);
+        for (int cz = 0; cz < MESHBENCH_SIZE; cz++) {
+            for (int cx = 0; cx < MESHBENCH_SIZE; cx++) {
+                Chunk* chunk = world.add(cx, cz);
+                generator.generate(chunk->voxels, cx, cz, seed);
+            }
+        }
+        world.light();
+        meshbench_input input = fetch_chunks(world);
+        success &= run_meshing("generated seed " + std::to_string(seed), input,
+                               &facesRenderer, &greedyRenderer, facesTotal, greedyTotal);
+        chunksTotal += input.volumes.size();
+    }
+
+    meshbench_blocks blocks;
+    blocks.stone = content->requireBlock("base:stone")->rt.id;
+    blocks.dirt = content->requireBlock("base:dirt")->rt.id;
+    blocks.grass = content->requireBlock("base:grass_block")->rt.id;
+    blocks.glass = content->requireBlock("base:glass")->rt.id;
+    blocks.leaves = content->requireBlock("base:leaves")->rt.id;
+    blocks.models[0] = content->requireBlock("base:grass")->rt.id;
+    blocks.models[1] = content->requireBlock("base:flower")->rt.id;
+    blocks.models[2] = content->requireBlock("base:torch")->rt.id;
+    blocks.models[3] = content->requireBlock("base:pane")->rt.id;
+
+    for (const auto& layout : MESHBENCH_LAYOUTS) {
+        meshbench_world world(content);
+        for (int cz = 0; cz < MESHBENCH_SIZE; cz++) {
+            for (int cx = 0; cx < MESHBENCH_SIZE; cx++) {
+                Chunk* chunk = world.add(cx, cz);
+                for (int y = 0; y < CHUNK_H; y++) {
+                    for (int z = 0; z < CHUNK_D; z++) {
+                        for (int x = 0; x < CHUNK_W; x++) {
+                            int gx = cx * CHUNK_W + x;
+                            int gz = cz * CHUNK_D + z;
+                            chunk->voxels[vox_index(x, y, z)] = layout.block(gx, y, gz, blocks);
+                        }
+                    }
+                }
+            }
+        }
+        world.light();
+        meshbench_input input = fetch_chunks(world);
+        success &= run_meshing(layout.name, input,
+                               &facesRenderer, &greedyRenderer, facesTotal, greedyTotal);
+        chunksTotal += input.volumes.size();
+    }
+
+    std::cout << "total" << std::endl;
+    print_result("faces", facesTotal, chunksTotal);
+    print_result("greedy", greedyTotal, chunksTotal);
+    return success;
+}
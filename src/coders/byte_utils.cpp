@@ -210,3 +210,7 @@ std::string ByteReader::getString() {
 bool ByteReader::hasNext() const {
     return pos < size;
 }
+
+size_t ByteReader::remaining() const {
+    return size - pos;
+}
@@ -37,6 +37,11 @@ public:
     inline size_t size() const {
         return buffer.size();
     }
+    /* Allocate space for more bytes at once (puts reserve exactly
+       the bytes written, so long sequences should reserve ahead) */
+    inline void reserve(size_t more) {
+        buffer.reserve(buffer.size() + more);
+    }
     inline const ubyte* data() const {
         return buffer.data();
     }
@@ -71,6 +76,8 @@ public:
     const char* getCString();
     std::string getString();
     bool hasNext() const;
+    /* @return number of bytes left to read */
+    size_t remaining() const;
 };
 
 #endif // CODERS_BYTE_UTILS_H_
@@ -24,6 +24,7 @@ toml::Wrapper* create_wrapper(EngineSettings& settings) {
 	chunks.add("load-distance", &settings.chunks.loadDistance);
 	chunks.add("load-speed", &settings.chunks.loadSpeed);
 	chunks.add("padding", &settings.chunks.padding);
+	chunks.add("far-distance", &settings.chunks.farDistance);
 	
 	toml::Section& camera = wrapper->add("camera");
 	camera.add("fov-effects", &settings.camera.fovEvents);
@@ -35,6 +36,9 @@ toml::Wrapper* create_wrapper(EngineSettings& settings) {
 	graphics.add("fog-curve", &settings.graphics.fogCurve);
 	graphics.add("backlight", &settings.graphics.backlight);
 	graphics.add("frustum-culling", &settings.graphics.frustumCulling);
+	graphics.add("cave-culling", &settings.graphics.caveCulling);
+	graphics.add("greedy-meshing", &settings.graphics.greedyMeshing);
+	graphics.add("mesh-cache", &settings.graphics.meshCache);
 	graphics.add("skybox-resolution", &settings.graphics.skyboxResolution);
 
 	toml::Section& debug = wrapper->add("debug");
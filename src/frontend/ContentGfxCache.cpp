@@ -1,41 +1,82 @@
 #include "ContentGfxCache.h"
 
 #include <string>
+#include <stdexcept>
+#include <unordered_map>
 
 #include "../assets/Assets.h"
 #include "../content/Content.h"
 #include "../graphics/Atlas.h"
+#include "../graphics/ImageData.h"
 #include "../voxels/Block.h"
 
 ContentGfxCache::ContentGfxCache(const Content* content, Assets* assets) {
     auto indices = content->getIndices();
-    sideregions = new UVRegion[indices->countBlockDefs() * 6];
+    sideregions.reset(new uint[indices->countBlockDefs() * 6]);
 	Atlas* atlas = assets->getAtlas("blocks");
+
+	std::unordered_map<std::string, uint> regionIndices;
+	auto getRegion = [&](const std::string& name) {
+		std::string tex = atlas->has(name) ? name : "notfound";
+		auto found = regionIndices.find(tex);
+		if (found != regionIndices.end()) {
+			return found->second;
+		}
+		if (regions.size() >= MAX_REGIONS) {
+			throw std::runtime_error("too many block textures");
+		}
+		uint index = regions.size();
+		regions.push_back(atlas->has(tex) ? atlas->get(tex) : UVRegion());
+		regionIndices[tex] = index;
+		return index;
+	};
 	
 	for (uint i = 0; i < indices->countBlockDefs(); i++) {
 		Block* def = indices->getBlockDef(i);
 		for (uint side = 0; side < 6; side++) {
-			std::string tex = def->textureFaces[side];
-			if (atlas->has(tex)) {
-				sideregions[i * 6 + side] = atlas->get(tex);
-			} else {
-				if (atlas->has("notfound"))
-					sideregions[i * 6 + side] = atlas->get("notfound");
-			}
+			sideregions[i * 6 + side] = getRegion(def->textureFaces[side]);
 		}
+		modelOffsets.push_back(modelregions.size());
 		for (uint side = 0; side < def->modelTextures.size(); side++)
 		{
-			std::string tex = def->modelTextures[side];
-			if (atlas->has(tex)) {
-				def->modelUVs.push_back(atlas->get(tex));
-			} else {
-				if (atlas->has("notfound"))
-					def->modelUVs.push_back(atlas->get("notfound"));
-			}
+			uint index = getRegion(def->modelTextures[side]);
+			modelregions.push_back(index);
+			def->modelUVs.push_back(regions[index]);
 		}
     }
 }
 
+ContentGfxCache::ContentGfxCache(const Content* content) {
+    auto indices = content->getIndices();
+    regions.push_back(UVRegion());
+    sideregions.reset(new uint[indices->countBlockDefs() * 6]{});
+	for (uint i = 0; i < indices->countBlockDefs(); i++) {
+		Block* def = indices->getBlockDef(i);
+		if (def->modelUVs.size() < def->modelTextures.size()) {
+			def->modelUVs.resize(def->modelTextures.size());
+		}
+		modelOffsets.push_back(modelregions.size());
+		modelregions.resize(modelregions.size() + def->modelTextures.size(), 0);
+	}
+}
+
 ContentGfxCache::~ContentGfxCache() {
-	delete[] sideregions;
+}
+
+ImageData* ContentGfxCache::createRegionsImage() const {
+	uint width = REGIONS_ROW * 2;
+	uint height = (regions.size() + REGIONS_ROW - 1) / REGIONS_ROW;
+	auto image = new ImageData(ImageFormat::rgba8888, width, height);
+	ubyte* data = (ubyte*)image->getData();
+	for (size_t i = 0; i < regions.size(); i++) {
+		const UVRegion& region = regions[i];
+		const float values[4] {region.u1, region.v1, region.u2, region.v2};
+		ubyte* dst = data + i * 8;
+		for (int j = 0; j < 4; j++) {
+			uint value = uint(values[j] * 65535.0f + 0.5f);
+			dst[j * 2] = value & 0xFF;
+			dst[j * 2 + 1] = (value >> 8) & 0xFF;
+		}
+	}
+	return image;
 }
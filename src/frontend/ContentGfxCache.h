@@ -1,22 +1,56 @@
 #ifndef FRONTEND_BLOCKS_GFX_CACHE_H_
 #define FRONTEND_BLOCKS_GFX_CACHE_H_
 
+#include <vector>
+#include <memory>
 #include "../graphics/UVRegion.h"
 #include "../typedefs.h"
 
 class Content;
 class Assets;
+class ImageData;
 
 class ContentGfxCache {
-    // array of block sides uv regions (6 per block)
-    UVRegion* sideregions;
+    // distinct atlas regions, chunks vertices refer them by index
+    std::vector<UVRegion> regions;
+    // array of block sides regions indices (6 per block)
+    std::unique_ptr<uint[]> sideregions;
+    // blocks model textures regions indices
+    std::vector<uint> modelregions;
+    // offsets of block model regions indices by block id
+    std::vector<size_t> modelOffsets;
 public:
+    /* Regions indices limit (vertex has 12 bits for index) */
+    static const uint MAX_REGIONS = 4096;
+    /* Regions per row of regions image */
+    static const uint REGIONS_ROW = 128;
+
     ContentGfxCache(const Content* content, Assets* assets);
+    /* Headless cache without atlas: all regions are the whole texture */
+    ContentGfxCache(const Content* content);
     ~ContentGfxCache();
 
     inline const UVRegion& getRegion(blockid_t id, int side) const {
+        return regions[sideregions[id * 6 + side]];
+    }
+
+    inline uint getRegionIndex(blockid_t id, int side) const {
         return sideregions[id * 6 + side];
     }
+
+    /* @return regions indices of 6 block sides */
+    inline const uint* getRegionIndices(blockid_t id) const {
+        return sideregions.get() + id * 6;
+    }
+
+    /* @return regions indices of block model textures */
+    inline const uint* getModelRegions(blockid_t id) const {
+        return modelregions.data() + modelOffsets[id];
+    }
+
+    /* Regions table for shader: region takes two RGBA texels,
+       u1, v1 and u2, v2 as 16 bit unorms (low byte first) */
+    ImageData* createRegionsImage() const;
 };
 
 #endif // FRONTEND_BLOCKS_GFX_CACHE_H_
@@ -7,16 +7,20 @@
 
 #include "../content/Content.h"
 #include "../graphics/ChunksRenderer.h"
+#include "../graphics/VisibilityGraph.h"
+#include "../graphics/FarTerrainRenderer.h"
 #include "../window/Window.h"
 #include "../window/Camera.h"
 #include "../graphics/Mesh.h"
 #include "../graphics/Atlas.h"
 #include "../graphics/Shader.h"
 #include "../graphics/Texture.h"
+#include "../graphics/ImageData.h"
 #include "../graphics/LineBatch.h"
 #include "../voxels/Chunks.h"
 #include "../voxels/Chunk.h"
 #include "../voxels/Block.h"
+#include "../voxels/FarTerrain.h"
 #include "../world/World.h"
 #include "../world/Level.h"
 #include "../world/LevelEvents.h"
@@ -29,6 +33,7 @@
 #include "../engine.h"
 #include "../items/ItemDef.h"
 #include "LevelFrontend.h"
+#include "ContentGfxCache.h"
 #include "graphics/Skybox.h"
 
 using glm::vec3;
@@ -41,10 +46,13 @@ WorldRenderer::WorldRenderer(Engine* engine, LevelFrontend* frontend)
 	: engine(engine), 
 	  level(frontend->getLevel()),
 	  frustumCulling(new Frustum()),
+	  visibility(new VisibilityGraph()),
 	  lineBatch(new LineBatch()),
 	  renderer(new ChunksRenderer(level, 
                 frontend->getContentGfxCache(), 
-                engine->getSettings())) {
+                engine->getSettings())),
+	  farRenderer(new FarTerrainRenderer(level->farTerrain,
+				frontend->getContentGfxCache())) {
 
 	auto& settings = engine->getSettings();
 	level->events->listen(EVT_CHUNK_HIDDEN, 
@@ -55,24 +63,27 @@ WorldRenderer::WorldRenderer(Engine* engine, LevelFrontend* frontend)
 	auto assets = engine->getAssets();
 	skybox = new Skybox(settings.graphics.skyboxResolution, 
 						assets->getShader("skybox_gen"));
+	std::unique_ptr<ImageData> regions (
+		frontend->getContentGfxCache()->createRegionsImage());
+	regionsTexture = Texture::from(regions.get());
 }
 
 WorldRenderer::~WorldRenderer() {
+	delete regionsTexture;
 	delete skybox;
 	delete lineBatch;
 	delete renderer;
+	delete farRenderer;
 	delete frustumCulling;
+	delete visibility;
 }
 
-bool WorldRenderer::drawChunk(size_t index,
-							  Camera* camera, 
+bool WorldRenderer::drawChunk(const draw_entry& entry,
 							  Shader* shader, 
-							  bool culling){
-	auto chunk = level->chunks->chunks[index];
-	if (!chunk->isLighted()) {
-		return false;
-	}
-	shared_ptr<Mesh> mesh = renderer->getOrRender(chunk.get());
+							  bool culling,
+							  const VisibilityGraph* visibility){
+	const Chunk* chunk = entry.chunk;
+	const chunk_mesh* mesh = entry.mesh;
 	if (mesh == nullptr) {
 		return false;
 	}
@@ -89,39 +100,179 @@ bool WorldRenderer::drawChunk(size_t index,
 	vec3 coord = vec3(chunk->x*CHUNK_W+0.5f, 0.5f, chunk->z*CHUNK_D+0.5f);
 	mat4 model = glm::translate(mat4(1.0f), coord);
 	shader->uniformMatrix("u_model", model);
-	mesh->draw();
+	for (int i = 0; i < MESH_SECTIONS; i++) {
+		const shared_ptr<Mesh>& section = mesh->sections[i];
+		if (section == nullptr)
+			continue;
+		if (visibility && !visibility->isVisible(chunk->x, i, chunk->z))
+			continue;
+		if (culling) {
+			vec3 min(chunk->x * CHUNK_W, 
+					 i * MESH_SECTION_H, 
+					 chunk->z * CHUNK_D);
+			vec3 max(chunk->x * CHUNK_W + CHUNK_W, 
+					 (i + 1) * MESH_SECTION_H, 
+					 chunk->z * CHUNK_D + CHUNK_D);
+			if (!frustumCulling->IsBoxVisible(min, max))
+				continue;
+		}
+		section->draw();
+	}
 	return true;
 }
 
+void WorldRenderer::updateDrawList(Chunks* chunks, Camera* camera) {
+	bool changed = drawListChunks.size() != chunks->volume;
+	drawListChunks.resize(chunks->volume);
+	for (size_t i = 0; i < chunks->volume; i++) {
+		Chunk* chunk = chunks->chunks[i].get();
+		if (drawListChunks[i] != chunk) {
+			drawListChunks[i] = chunk;
+			changed = true;
+		}
+	}
+	glm::ivec3 voxel = glm::floor(camera->position);
+	glm::ivec2 center(floordiv(voxel.x, CHUNK_W), floordiv(voxel.z, CHUNK_D));
+	if (!changed && center == drawListCenter) {
+		return;
+	}
+	drawListCenter = center;
+
+	if (changed) {
+		// keep order of chunks still in the matrix (entries of removed
+		// chunks are not dereferenced), new chunks go first as they are
+		// usually the farthest
+		std::vector<ubyte> listed(chunks->volume, 0);
+		size_t kept = 0;
+		for (const draw_entry& entry : drawList) {
+			int x = entry.x - chunks->ox;
+			int z = entry.z - chunks->oz;
+			if (x < 0 || z < 0 || x >= chunks->w || z >= chunks->d)
+				continue;
+			size_t index = z * chunks->w + x;
+			if (drawListChunks[index] != entry.chunk)
+				continue;
+			listed[index] = 1;
+			drawList[kept++] = entry;
+		}
+		drawList.resize(kept);
+		std::vector<draw_entry> added;
+		for (size_t i = 0; i < chunks->volume; i++) {
+			Chunk* chunk = drawListChunks[i];
+			if (chunk && !listed[i]) {
+				added.push_back({chunk, nullptr, chunk->x, chunk->z, 0});
+			}
+		}
+		drawList.insert(drawList.begin(), added.begin(), added.end());
+	}
+	for (draw_entry& entry : drawList) {
+		int dx = entry.x - center.x;
+		int dz = entry.z - center.y;
+		entry.distance = dx * dx + dz * dz;
+	}
+	// insertion sort, the list is nearly sorted already
+	for (size_t i = 1; i < drawList.size(); i++) {
+		draw_entry entry = drawList[i];
+		size_t j = i;
+		for (; j > 0 && drawList[j - 1].distance < entry.distance; j--) {
+			drawList[j] = drawList[j - 1];
+		}
+		drawList[j] = entry;
+	}
+}
+
 void WorldRenderer::drawChunks(Chunks* chunks, 
 							   Camera* camera, 
 							   Shader* shader) {
-	std::vector<size_t> indices;
-	for (size_t i = 0; i < chunks->volume; i++){
-		shared_ptr<Chunk> chunk = chunks->chunks[i];
-		if (chunk == nullptr)
+	renderer->update();
+	updateDrawList(chunks, camera);
+	// sections of chunks without mesh are passed through by cave culling
+	visibility->reset(chunks->w, MESH_SECTIONS, chunks->d, chunks->ox, chunks->oz);
+	for (draw_entry& entry : drawList) {
+		Chunk* chunk = entry.chunk;
+		entry.mesh = chunk->isLighted() ? renderer->getOrRender(chunk) : nullptr;
+		if (entry.mesh == nullptr)
 			continue;
-		indices.push_back(i);
+		for (int section = 0; section < MESH_SECTIONS; section++) {
+			visibility->set(chunk->x, section, chunk->z, entry.mesh->connectivity[section]);
+		}
 	}
-	float px = camera->position.x / (float)CHUNK_W;
-	float pz = camera->position.z / (float)CHUNK_D;
-	std::sort(indices.begin(), indices.end(), [this, chunks, px, pz](size_t i, size_t j) {
-		shared_ptr<Chunk> a = chunks->chunks[i];
-		shared_ptr<Chunk> b = chunks->chunks[j];
-		return ((a->x + 0.5f - px)*(a->x + 0.5f - px) + 
-				(a->z + 0.5f - pz)*(a->z + 0.5f - pz)
-				>
-				(b->x + 0.5f - px)*(b->x + 0.5f - px) + 
-				(b->z + 0.5f - pz)*(b->z + 0.5f - pz));
-	});
-
-	bool culling = engine->getSettings().graphics.frustumCulling;
+
+	auto& settings = engine->getSettings();
+	bool culling = settings.graphics.frustumCulling;
 	if (culling) {
 		frustumCulling->update(camera->getProjView());
 	}
+	bool caveCulling = false;
+	if (settings.graphics.caveCulling) {
+		glm::ivec3 voxel = glm::floor(camera->position);
+		caveCulling = visibility->collect(
+			floordiv(voxel.x, CHUNK_W), 
+			floordiv(voxel.y, MESH_SECTION_H), 
+			floordiv(voxel.z, CHUNK_D), 
+			[this, culling](int x, int y, int z) {
+				if (!culling) {
+					return true;
+				}
+				vec3 min(x * CHUNK_W, y * MESH_SECTION_H, z * CHUNK_D);
+				vec3 max(min.x + CHUNK_W, min.y + MESH_SECTION_H, min.z + CHUNK_D);
+				return frustumCulling->IsBoxVisible(min, max);
+			}
+		);
+	}
 	chunks->visible = 0;
-	for (size_t i = 0; i < indices.size(); i++){
-		chunks->visible += drawChunk(indices[i], camera, shader, culling);
+	for (const draw_entry& entry : drawList) {
+		chunks->visible += drawChunk(entry, shader, culling, 
+									 caveCulling ? visibility : nullptr);
+	}
+	drawFarTerrain(camera, shader, culling);
+}
+
+void WorldRenderer::drawFarTerrain(Camera* camera, Shader* shader, bool culling) {
+	// far meshes are cheap, but building all of them in one frame is not
+	const int MAX_FAR_MESHES_PER_FRAME = 16;
+
+	FarTerrain* farTerrain = level->farTerrain;
+	// far chunk is drawn until the full chunk mesh is built, then it is
+	// removed (full chunk meshes are uploaded before far terrain is drawn)
+	std::vector<glm::ivec2> replaced;
+	for (auto& entry : farTerrain->getChunks()) {
+		const shared_ptr<FarChunk>& chunk = entry.second;
+		Chunk* full = level->chunks->getChunk(chunk->x, chunk->z);
+		if (full && full->isLighted() && renderer->get(full)) {
+			replaced.push_back(entry.first);
+		}
+	}
+	for (const glm::ivec2& pos : replaced) {
+		farTerrain->remove(pos.x, pos.y);
+	}
+
+	farRenderer->update();
+	int built = 0;
+	for (auto& entry : farTerrain->getChunks()) {
+		const shared_ptr<FarChunk>& chunk = entry.second;
+		if (culling){
+			vec3 min(chunk->x * CHUNK_W, 
+					 chunk->bottom, 
+					 chunk->z * CHUNK_D);
+			vec3 max(chunk->x * CHUNK_W + CHUNK_W, 
+					 chunk->top, 
+					 chunk->z * CHUNK_D + CHUNK_D);
+
+			if (!frustumCulling->IsBoxVisible(min, max)) continue;
+		}
+		shared_ptr<Mesh> mesh = farRenderer->get(chunk);
+		if (mesh == nullptr) {
+			if (built >= MAX_FAR_MESHES_PER_FRAME) {
+				continue;
+			}
+			mesh = farRenderer->render(chunk);
+			built++;
+		}
+		vec3 coord = vec3(chunk->x*CHUNK_W, 0.0f, chunk->z*CHUNK_D);
+		mat4 model = glm::translate(mat4(1.0f), coord);
+		shader->uniformMatrix("u_model", model);
+		mesh->draw();
 	}
 }
 
@@ -157,7 +308,9 @@ void WorldRenderer::draw(const GfxContext& pctx, Camera* camera, bool hudVisible
 		ctx.depthTest(true);
 		ctx.cullFace(true);
 
-		float fogFactor = 15.0f / ((float)settings.chunks.loadDistance-2);
+		uint viewDistance = std::max(settings.chunks.loadDistance, 
+									 settings.chunks.farDistance);
+		float fogFactor = 15.0f / ((float)viewDistance-2);
 
 		// Setting up main shader
 		shader->use();
@@ -168,6 +321,7 @@ void WorldRenderer::draw(const GfxContext& pctx, Camera* camera, bool hudVisible
 		shader->uniform1f("u_fogCurve", settings.graphics.fogCurve);
 		shader->uniform3f("u_cameraPos", camera->position);
 		shader->uniform1i("u_cubemap", 1);
+		shader->uniform1i("u_regions", 2);
 		{
 			itemid_t id = level->player->getChosenItem();
             ItemDef* item = indices->getItemDef(id);
@@ -182,6 +336,9 @@ void WorldRenderer::draw(const GfxContext& pctx, Camera* camera, bool hudVisible
 
 		// Binding main shader textures
 		skybox->bind();
+		glActiveTexture(GL_TEXTURE2);
+		regionsTexture->bind();
+		glActiveTexture(GL_TEXTURE0);
 		atlas->getTexture()->bind();
 
 		drawChunks(level->chunks, camera, shader);
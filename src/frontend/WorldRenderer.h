@@ -16,23 +16,53 @@ class Level;
 class Camera;
 class LineBatch;
 class ChunksRenderer;
+class FarTerrainRenderer;
 class Shader;
 class Texture;
 class Frustum;
+class VisibilityGraph;
 class Engine;
+class Chunk;
 class Chunks;
+struct chunk_mesh;
 class LevelFrontend;
 class Skybox;
 
 class WorldRenderer {
+	struct draw_entry {
+		Chunk* chunk;
+		/* refreshed every frame */
+		chunk_mesh* mesh;
+		/* chunk position, kept to check entry without chunk access */
+		int x, z;
+		/* squared distance in chunks to the camera chunk */
+		int distance;
+	};
+
 	Engine* engine;
 	Level* level;
 	Frustum* frustumCulling;
+	VisibilityGraph* visibility;
 	LineBatch* lineBatch;
 	ChunksRenderer* renderer;
+	FarTerrainRenderer* farRenderer;
 	Skybox* skybox;
-	bool drawChunk(size_t index, Camera* camera, Shader* shader, bool culling);
+	/* Atlas regions table chunks vertices refer to */
+	Texture* regionsTexture;
+	/* Chunks sorted farthest first. Kept between frames and sorted again
+	   only when the camera moves to another chunk or chunks are changed */
+	std::vector<draw_entry> drawList;
+	/* Chunks matrix the draw list is made of */
+	std::vector<Chunk*> drawListChunks;
+	glm::ivec2 drawListCenter {0, 0};
+
+	void updateDrawList(Chunks* chunks, Camera* camera);
+	/* @param visibility sections visible from the camera (nullable) */
+	bool drawChunk(const draw_entry& entry, Shader* shader, bool culling,
+				   const VisibilityGraph* visibility);
 	void drawChunks(Chunks* chunks, Camera* camera, Shader* shader);
+	/* Draw reduced detail terrain where chunks are not lighted yet */
+	void drawFarTerrain(Camera* camera, Shader* shader, bool culling);
 public:
 	WorldRenderer(Engine* engine, LevelFrontend* frontend);
 	~WorldRenderer();
@@ -30,7 +30,7 @@ Skybox::Skybox(uint size, Shader* shader) : size(size), shader(shader) {
         -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
         -1.0f, -1.0f,  1.0f, 1.0f, 1.0f, -1.0f
     };
-    vattr attrs[] {2, 0};
+    vattr attrs[] {{2}, {0}};
     mesh = new Mesh(vertices, 6, attrs);
 }
 
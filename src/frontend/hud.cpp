@@ -20,6 +20,7 @@
 #include "../graphics/Font.h"
 #include "../graphics/Atlas.h"
 #include "../graphics/Mesh.h"
+#include "../graphics/BlocksRenderer.h"
 #include "../window/Camera.h"
 #include "../window/Window.h"
 #include "../window/Events.h"
@@ -71,6 +72,11 @@ void HudRenderer::createDebugPanel(Engine* engine) {
 	panel->add(create_label([this](){
 		return L"meshes: " + std::to_wstring(Mesh::meshesCount);
 	}));
+	panel->add(create_label([](){
+		return L"mesh buffers grown: " + 
+			   std::to_wstring(BlocksRenderer::buffersGrowths) +
+			   L" max quads: " + std::to_wstring(BlocksRenderer::maxQuads);
+	}));
 	panel->add(create_label([=](){
 		auto& settings = engine->getSettings();
 		bool culling = settings.graphics.frustumCulling;
@@ -1,15 +1,14 @@
 #include "BlocksRenderer.h"
 
+#include <algorithm>
 #include <glm/glm.hpp>
 
-#include "Mesh.h"
-#include "UVRegion.h"
+#include "MeshData.h"
+#include "CornerLights.h"
 #include "../constants.h"
 #include "../content/Content.h"
 #include "../voxels/Block.h"
-#include "../voxels/Chunk.h"
 #include "../voxels/VoxelsVolume.h"
-#include "../voxels/ChunksStorage.h"
 #include "../lighting/Lightmap.h"
 #include "../frontend/ContentGfxCache.h"
 
@@ -17,52 +16,114 @@ using glm::ivec3;
 using glm::vec3;
 using glm::vec4;
 
-const uint BlocksRenderer::VERTEX_SIZE = 6;
+const uint BlocksRenderer::VERTEX_SIZE = 3;
+/* Initial mesh buffers size in quads, buffers grow twice when full */
+const size_t INITIAL_QUADS = 1024;
+std::atomic<uint> BlocksRenderer::buffersGrowths (0);
+std::atomic<size_t> BlocksRenderer::maxQuads (0);
+/* Open codes of voxels for faces visibility, other codes are draw groups
+   of light passing blocks hiding faces of the same group only */
+const uint16_t OPEN_ALL = 0x100;
+const uint16_t OPEN_NONE = 0x200;
 const vec3 BlocksRenderer::SUN_VECTOR (0.411934f, 0.863868f, -0.279161f);
 
-BlocksRenderer::BlocksRenderer(size_t capacity,
-	const Content* content,
+BlocksRenderer::BlocksRenderer(const Content* content,
 	const ContentGfxCache* cache,
 	const EngineSettings& settings)
 	: content(content),
 	vertexOffset(0),
 	indexOffset(0),
 	indexSize(0),
-	capacity(capacity),
 	cache(cache),
 	settings(settings) {
-	vertexBuffer = new float[capacity];
-	indexBuffer = new int[capacity];
-	voxelsBuffer = new VoxelsVolume(CHUNK_W + 2, CHUNK_H, CHUNK_D + 2);
+	cornerLights = new CornerLights();
+	greedyFaces.resize(CHUNK_VOL);
 	blockDefsCache = content->getIndices()->getBlockDefs();
+	faceMasks.reset(new ubyte[CHUNK_VOL]);
+	openCodes.reset(new uint16_t[(CHUNK_W + 2) * (CHUNK_H + 2) * (CHUNK_D + 2)]);
+
+	auto indices = content->getIndices();
+	for (blockid_t id = 0; id < indices->countBlockDefs(); id++) {
+		const Block& def = *blockDefsCache[id];
+		block_props props;
+		props.drawGroup = def.drawGroup;
+		props.model = def.model;
+		auto group = content->drawGroups->find(def.drawGroup);
+		if (group == content->drawGroups->end()) {
+			props.groupIndex = NO_GROUP;
+		} else {
+			props.groupIndex = std::distance(content->drawGroups->begin(), group);
+		}
+		if (id == 0 || !def.rt.solid) {
+			props.openCode = OPEN_ALL;
+		} else if (def.lightPassing) {
+			props.openCode = def.drawGroup;
+		} else {
+			props.openCode = OPEN_NONE;
+		}
+		blockProps.push_back(props);
+	}
+	groupsBlocks.resize(content->drawGroups->size());
 }
 
 BlocksRenderer::~BlocksRenderer() {
-	delete voxelsBuffer;
-	delete[] vertexBuffer;
-	delete[] indexBuffer;
+	delete cornerLights;
 }
 
-/* Basic vertex add method */
-void BlocksRenderer::vertex(const vec3& coord, float u, float v, const vec4& light) {
-	vertexBuffer[vertexOffset++] = coord.x;
-	vertexBuffer[vertexOffset++] = coord.y;
-	vertexBuffer[vertexOffset++] = coord.z;
+/* Position is quantized to 1/32 of block with 8 blocks offset, so x and z
+   take 10 bits, y takes 14 bits; region index takes 12 bits and texture
+   coordinates take 9 bits each:
+   [0] x | z << 10 | region << 20
+   [1] y | u << 14 | v << 23
+   [2] light */
+void BlocksRenderer::packVertex(uint32_t* dst, const vec3& coord, 
+								float u, float v, uint32_t light, uint region) {
+	const vec3 position = glm::clamp((coord + 8.0f) * 32.0f + 0.5f, 0.0f, 16383.0f);
+	const uint x = std::min(uint(position.x), 0x3FFU);
+	const uint y = uint(position.y);
+	const uint z = std::min(uint(position.z), 0x3FFU);
+	dst[0] = x | (z << 10) | ((region & 0xFFF) << 20);
+	dst[1] = y | ((uint(u + 0.5f) & 0x1FF) << 14) | ((uint(v + 0.5f) & 0x1FF) << 23);
+	dst[2] = light;
+}
 
-	vertexBuffer[vertexOffset++] = u;
-	vertexBuffer[vertexOffset++] = v;
+inline uint32_t pack_light(const vec4& light) {
+	uint32_t packed = (uint32_t(light.r * 255) & 0xff) << 24;
+	packed |= (uint32_t(light.g * 255) & 0xff) << 16;
+	packed |= (uint32_t(light.b * 255) & 0xff) << 8;
+	packed |= (uint32_t(light.a * 255) & 0xff);
+	return packed;
+}
 
-	union {
-		float floating;
-		uint32_t integer;
-	} compressed;
+/* @return 1 if voxel with the open code does not hide faces
+   of the draw group blocks */
+inline ubyte is_open(uint16_t code, uint16_t group) {
+	return code == OPEN_ALL || (code < OPEN_ALL && code != group);
+}
+
+/* Basic vertex add method
+   @param u,v texture coordinates in tiles (whole), texture repeats every tile
+   @param light packed light
+   @param region index of the texture atlas region in ContentGfxCache */
+void BlocksRenderer::vertex(const vec3& coord, float u, float v, 
+							uint32_t light, uint region) {
+	packVertex(vertexBuffer + vertexOffset, coord, u, v, light, region);
+	vertexOffset += VERTEX_SIZE;
+}
 
-	compressed.integer = (uint32_t(light.r * 255) & 0xff) << 24;
-	compressed.integer |= (uint32_t(light.g * 255) & 0xff) << 16;
-	compressed.integer |= (uint32_t(light.b * 255) & 0xff) << 8;
-	compressed.integer |= (uint32_t(light.a * 255) & 0xff);
+void BlocksRenderer::vertex(const vec3& coord, float u, float v, 
+							const vec4& light, uint region) {
+	vertex(coord, u, v, pack_light(light), region);
+}
 
-	vertexBuffer[vertexOffset++] = compressed.floating;
+/* Grow mesh buffers twice, buffer contents are kept */
+void BlocksRenderer::grow() {
+	size_t quads = std::max(INITIAL_QUADS, mesh->indices.size() / 6 * 2);
+	mesh->vertices.resize(quads * 4 * VERTEX_SIZE);
+	mesh->indices.resize(quads * 6);
+	vertexBuffer = mesh->vertices.data();
+	indexBuffer = mesh->indices.data();
+	buffersGrowths++;
 }
 
 void BlocksRenderer::index(int a, int b, int c, int d, int e, int f) {
@@ -81,21 +142,18 @@ void BlocksRenderer::face(const vec3& coord,
 						  const vec3& axisX,
 						  const vec3& axisY,
                           const vec3& axisZ,
-						  const UVRegion& region,
+						  uint region,
 						  const vec4(&lights)[4],
 						  const vec4& tint) {
-	if (vertexOffset + BlocksRenderer::VERTEX_SIZE * 4 > capacity) {
-		overflow = true;
-		return;
-	}
+	reserveQuad();
     vec3 X = axisX * w;
     vec3 Y = axisY * h;
     vec3 Z = axisZ * d;
     float s = 0.5f;
-	vertex(coord + (-X - Y + Z) * s, region.u1, region.v1, lights[0] * tint);
-	vertex(coord + ( X - Y + Z) * s, region.u2, region.v1, lights[1] * tint);
-	vertex(coord + ( X + Y + Z) * s, region.u2, region.v2, lights[2] * tint);
-	vertex(coord + (-X + Y + Z) * s, region.u1, region.v2, lights[3] * tint);
+	vertex(coord + (-X - Y + Z) * s, 0.0f, 0.0f, lights[0] * tint, region);
+	vertex(coord + ( X - Y + Z) * s, 1.0f, 0.0f, lights[1] * tint, region);
+	vertex(coord + ( X + Y + Z) * s, 1.0f, 1.0f, lights[2] * tint, region);
+	vertex(coord + (-X + Y + Z) * s, 0.0f, 1.0f, lights[3] * tint, region);
 	index(0, 1, 3, 1, 2, 3);
 }
 
@@ -104,26 +162,30 @@ void BlocksRenderer::vertex(const vec3& coord,
 							const vec4& tint,
 							const vec3& X,
 							const vec3& Y,
-							const vec3& Z) {
+							const vec3& Z,
+							uint region) {
+	vertex(coord, u, v, vertexLight(coord, X, Y, Z) * tint, region);
+}
+
+vec4 BlocksRenderer::vertexLight(const vec3& coord, 
+								 const vec3& X, 
+								 const vec3& Y, 
+								 const vec3& Z) const {
     // TODO: optimize
     vec3 axisX = glm::normalize(X);
     vec3 axisY = glm::normalize(Y);
     vec3 axisZ = glm::normalize(Z);
     vec3 pos = coord+axisZ*0.5f+(axisX+axisY)*0.5f;
-	vec4 light = pickSoftLight(ivec3(round(pos.x), round(pos.y), round(pos.z)), axisX, axisY);
-	vertex(coord, u, v, light * tint);
+	return pickSoftLight(ivec3(round(pos.x), round(pos.y), round(pos.z)), axisX, axisY);
 }
 
 void BlocksRenderer::face(const vec3& coord,
 						  const vec3& X,
 						  const vec3& Y,
 						  const vec3& Z,
-						  const UVRegion& region,
+						  uint region,
                           bool lights) {
-	if (vertexOffset + BlocksRenderer::VERTEX_SIZE * 4 > capacity) {
-		overflow = true;
-		return;
-	}
+	reserveQuad();
 
     float s = 0.5f;
     if (lights) {
@@ -131,16 +193,16 @@ void BlocksRenderer::face(const vec3& coord,
         d = 0.7f + d * 0.3f;
 
         vec4 tint(d);
-        vertex(coord + (-X - Y + Z) * s, region.u1, region.v1, tint, X, Y, Z);
-        vertex(coord + ( X - Y + Z) * s, region.u2, region.v1, tint, X, Y, Z);
-        vertex(coord + ( X + Y + Z) * s, region.u2, region.v2, tint, X, Y, Z);
-        vertex(coord + (-X + Y + Z) * s, region.u1, region.v2, tint, X, Y, Z);
+        vertex(coord + (-X - Y + Z) * s, 0.0f, 0.0f, tint, X, Y, Z, region);
+        vertex(coord + ( X - Y + Z) * s, 1.0f, 0.0f, tint, X, Y, Z, region);
+        vertex(coord + ( X + Y + Z) * s, 1.0f, 1.0f, tint, X, Y, Z, region);
+        vertex(coord + (-X + Y + Z) * s, 0.0f, 1.0f, tint, X, Y, Z, region);
     } else {
         vec4 tint(1.0f);
-        vertex(coord + (-X - Y + Z) * s, region.u1, region.v1, tint);
-        vertex(coord + ( X - Y + Z) * s, region.u2, region.v1, tint);
-        vertex(coord + ( X + Y + Z) * s, region.u2, region.v2, tint);
-        vertex(coord + (-X + Y + Z) * s, region.u1, region.v2, tint);
+        vertex(coord + (-X - Y + Z) * s, 0.0f, 0.0f, tint, region);
+        vertex(coord + ( X - Y + Z) * s, 1.0f, 0.0f, tint, region);
+        vertex(coord + ( X + Y + Z) * s, 1.0f, 1.0f, tint, region);
+        vertex(coord + (-X + Y + Z) * s, 0.0f, 1.0f, tint, region);
     }
 	index(0, 1, 2, 0, 2, 3);
 }
@@ -150,8 +212,9 @@ void BlocksRenderer::tetragonicFace(const vec3& coord, const vec3& p1,
 									const vec3& X,
 									const vec3& Y,
 									const vec3& Z,
-									const UVRegion& texreg,
+									uint texreg,
 									bool lights) {
+	reserveQuad();
     
     const vec3 fp1 = (p1.x - 0.5f) * X + (p1.y - 0.5f) * Y + (p1.z - 0.5f) * Z;
     const vec3 fp2 = (p2.x - 0.5f) * X + (p2.y - 0.5f) * Y + (p2.z - 0.5f) * Z;
@@ -172,17 +235,17 @@ void BlocksRenderer::tetragonicFace(const vec3& coord, const vec3& p1,
         // tint.y = normal.y * 0.5f + 0.5f;
         // tint.z = normal.z * 0.5f + 0.5f;
     }
-	vertex(coord + fp1, texreg.u1, texreg.v1, tint);
-	vertex(coord + fp2, texreg.u2, texreg.v1, tint);
-	vertex(coord + fp3, texreg.u2, texreg.v2, tint);
-	vertex(coord + fp4, texreg.u1, texreg.v2, tint);
+	vertex(coord + fp1, 0.0f, 0.0f, tint, texreg);
+	vertex(coord + fp2, 1.0f, 0.0f, tint, texreg);
+	vertex(coord + fp3, 1.0f, 1.0f, tint, texreg);
+	vertex(coord + fp4, 0.0f, 1.0f, tint, texreg);
 	index(0, 1, 3, 1, 2, 3);
 }
 
 void BlocksRenderer::blockXSprite(int x, int y, int z, 
 								  const vec3& size, 
-								  const UVRegion& texface1, 
-								  const UVRegion& texface2, 
+								  uint texface1, 
+								  uint texface2, 
 								  float spread) {
 	vec4 lights[]{
 			pickSoftLight({x, y + 1, z}, {1, 0, 0}, {0, 1, 0}),
@@ -217,7 +280,7 @@ void BlocksRenderer::blockXSprite(int x, int y, int z,
 
 /* AABB blocks render method */
 void BlocksRenderer::blockAABB(const ivec3& icoord,
-							   const UVRegion(&texfaces)[6], 
+							   const uint* texfaces, 
 							   const Block* block, ubyte rotation,
                                bool lights) {
 	AABB hitbox = block->hitbox;
@@ -255,6 +318,7 @@ void BlocksRenderer::blockCustomModel(const ivec3& icoord,
 	vec3 Z(0, 0, 1);
 	CoordSystem orient(X,Y,Z);
 	vec3 coord(icoord);
+	const uint* uvs = cache->getModelRegions(block->rt.id);
 	if (block->rotatable) {
 		auto& rotations = block->rotations;
 		orient = rotations.variants[rotation];
@@ -270,12 +334,12 @@ void BlocksRenderer::blockCustomModel(const ivec3& icoord,
 			orient.transform(box);
 		}
 		vec3 center_coord = coord - vec3(0.5f) + box.center();
-		face(center_coord, X * size.x, Y * size.y, Z * size.z, block->modelUVs[i * 6 + 5], lights); // north
-		face(center_coord, -X * size.x, Y * size.y, -Z * size.z, block->modelUVs[i * 6 + 4], lights); // south
-		face(center_coord, X * size.x, -Z * size.z, Y * size.y, block->modelUVs[i * 6 + 3], lights); // top
-		face(center_coord, -X * size.x, -Z * size.z, -Y * size.y, block->modelUVs[i * 6 + 2], lights); // bottom
-		face(center_coord, -Z * size.z, Y * size.y, X * size.x, block->modelUVs[i * 6 + 1], lights); // west
-		face(center_coord, Z * size.z, Y * size.y, -X * size.x, block->modelUVs[i * 6 + 0], lights); // east
+		face(center_coord, X * size.x, Y * size.y, Z * size.z, uvs[i * 6 + 5], lights); // north
+		face(center_coord, -X * size.x, Y * size.y, -Z * size.z, uvs[i * 6 + 4], lights); // south
+		face(center_coord, X * size.x, -Z * size.z, Y * size.y, uvs[i * 6 + 3], lights); // top
+		face(center_coord, -X * size.x, -Z * size.z, -Y * size.y, uvs[i * 6 + 2], lights); // bottom
+		face(center_coord, -Z * size.z, Y * size.y, X * size.x, uvs[i * 6 + 1], lights); // west
+		face(center_coord, Z * size.z, Y * size.y, -X * size.x, uvs[i * 6 + 0], lights); // east
 	}
 	
 	for (size_t i = 0; i < block->modelExtraPoints.size()/4; i++) {
@@ -285,21 +349,39 @@ void BlocksRenderer::blockCustomModel(const ivec3& icoord,
 			block->modelExtraPoints[i * 4 + 2],
 			block->modelExtraPoints[i * 4 + 3],
 			X, Y, Z,
-			block->modelUVs[block->modelBoxes.size()*6 + i], lights);
+			uvs[block->modelBoxes.size()*6 + i], lights);
+	}
+}
+
+/* Directions of full block faces normals and axes */
+static const ivec3 DIRECTIONS[6] {
+	{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
+};
+
+inline ubyte direction_index(const ivec3& dir) {
+	ubyte index = 0;
+	while (index < 5 && DIRECTIONS[index] != dir) {
+		index++;
 	}
+	return index;
+}
+
+/* @return true if voxel face looking in the direction is visible
+   @param mask voxel face visibility mask (see buildFaceMasks) */
+inline bool has_face(ubyte mask, const ivec3& dir) {
+	return mask & (1 << direction_index(dir));
 }
 
 /* Fastest solid shaded blocks render method */
 void BlocksRenderer::blockCube(int x, int y, int z, 
-									 const UVRegion(&texfaces)[6], 
+									 const uint* texfaces, 
 									 const Block* block, 
 									 ubyte states,
                                      bool lights) {
-	ubyte group = block->drawGroup;
-
-	vec3 X(1, 0, 0);
-	vec3 Y(0, 1, 0);
-	vec3 Z(0, 0, 1);
+	const ubyte mask = faceMasks[(y * CHUNK_D + z) * CHUNK_W + x];
+	ivec3 X(1, 0, 0);
+	ivec3 Y(0, 1, 0);
+	ivec3 Z(0, 0, 1);
 	vec3 coord(x, y, z);
 	if (block->rotatable) {
 		auto& rotations = block->rotations;
@@ -309,44 +391,167 @@ void BlocksRenderer::blockCube(int x, int y, int z,
 		Z = orient.axisZ;
 	}
 	
-	if (isOpen(x+Z.x, y+Z.y, z+Z.z, group)) {
-	    face(coord, X, Y, Z, texfaces[5], lights);
+	if (has_face(mask, Z)) {
+	    face(coord, vec3(X), vec3(Y), vec3(Z), texfaces[5], lights);
 	}
-	if (isOpen(x-Z.x, y-Z.y, z-Z.z, group)) {
-	    face(coord, -X, Y, -Z, texfaces[4], lights);
+	if (has_face(mask, -Z)) {
+	    face(coord, vec3(-X), vec3(Y), vec3(-Z), texfaces[4], lights);
 	}
-	if (isOpen(x+Y.x, y+Y.y, z+Y.z, group)) {
-		face(coord, X, -Z, Y, texfaces[3], lights);
+	if (has_face(mask, Y)) {
+		face(coord, vec3(X), vec3(-Z), vec3(Y), texfaces[3], lights);
 	}
-	if (isOpen(x-Y.x, y-Y.y, z-Y.z, group)) {
-		face(coord, X, Z, -Y, texfaces[2], lights);
+	if (has_face(mask, -Y)) {
+		face(coord, vec3(X), vec3(Z), vec3(-Y), texfaces[2], lights);
 	}
-	if (isOpen(x+X.x, y+X.y, z+X.z, group)) {
-		face(coord, -Z, Y, X, texfaces[1], lights);
+	if (has_face(mask, X)) {
+		face(coord, vec3(-Z), vec3(Y), vec3(X), texfaces[1], lights);
 	}
-	if (isOpen(x-X.x, y-X.y, z-X.z, group)) {
-		face(coord, Z, Y, -X, texfaces[0], lights);
+	if (has_face(mask, -X)) {
+		face(coord, vec3(Z), vec3(Y), vec3(-X), texfaces[0], lights);
 	}
 }
 
-// Does block allow to see other blocks sides (is it transparent)
-bool BlocksRenderer::isOpen(int x, int y, int z, ubyte group) const {
-	blockid_t id = voxelsBuffer->pickBlockId(chunk->x * CHUNK_W + x, 
-											 y, 
-											 chunk->z * CHUNK_D + z);
-	if (id == BLOCK_VOID)
-		return false;
-	const Block& block = *blockDefsCache[id];
-	if ((block.drawGroup != group && block.lightPassing) || !block.rt.solid) {
-		return true;
+/* Faces of full blocks collected by render loop are processed for each
+   direction. Faces with the same texture region, axes and light in all
+   corners are merged to larger quads with repeated texture, other ones
+   are added as is. Blocks are in y, z, x order, so every slice is
+   scanned row by row */
+void BlocksRenderer::blockCubesGreedy() {
+	// texture faces indices of blockCube faces
+	static const int sides[6] {5, 4, 3, 2, 1, 0};
+	// voxel index steps and sizes along x, y, z
+	static const int steps[3] {1, CHUNK_W * CHUNK_D, CHUNK_W};
+	static const int sizes[3] {CHUNK_W, CHUNK_H, CHUNK_D};
+	const voxel* voxels = voxelsBuffer->getVoxels();
+	for (int direction = 0; direction < 6; direction++) {
+		const ivec3& normal = DIRECTIONS[direction];
+		const vec3 FZ(normal);
+		const float sunlight = 0.7f + glm::dot(FZ, SUN_VECTOR) * 0.3f;
+		for (uint index : greedyBlocks) {
+			if (!(faceMasks[index] & (1 << direction)))
+				continue;
+			const int x = index % CHUNK_W;
+			const int y = index / (CHUNK_W * CHUNK_D);
+			const int z = index / CHUNK_W % CHUNK_D;
+			const voxel& vox = voxels[vox_index(x + 1, y, z + 1, CHUNK_W + 2, CHUNK_D + 2)];
+			const Block& def = *blockDefsCache[vox.id];
+			ivec3 X(1, 0, 0);
+			ivec3 Y(0, 1, 0);
+			ivec3 Z(0, 0, 1);
+			if (def.rotatable) {
+				auto& orient = def.rotations.variants[vox.rotation()];
+				X = orient.axisX;
+				Y = orient.axisY;
+				Z = orient.axisZ;
+			}
+			// same faces as in blockCube: {axisX, axisY, normal}
+			const ivec3 faces[6][3] {
+				{X, Y, Z}, {-X, Y, -Z}, {X, -Z, Y}, 
+				{X, Z, -Y}, {-Z, Y, X}, {Z, Y, -X}
+			};
+			int side = 0;
+			while (side < 6 && faces[side][2] != normal) {
+				side++;
+			}
+			if (side == 6)
+				continue;
+			const ivec3& axisX = faces[side][0];
+			const ivec3& axisY = faces[side][1];
+			uint region = cache->getRegionIndex(vox.id, sides[side]);
+
+			uint32_t lights[4];
+			if (def.rt.emissive) {
+				lights[0] = lights[1] = lights[2] = lights[3] = pack_light(vec4(1.0f));
+			} else {
+				const vec3 coord(x, y, z);
+				const vec3 FX(axisX);
+				const vec3 FY(axisY);
+				const vec3 corners[4] {-FX - FY, FX - FY, FX + FY, -FX + FY};
+				for (int i = 0; i < 4; i++) {
+					vec3 vpos = coord + (corners[i] + FZ) * 0.5f;
+					lights[i] = pack_light(vertexLight(vpos, FX, FY, FZ) * sunlight);
+				}
+			}
+			if (lights[0] != lights[1] || lights[0] != lights[2] || lights[0] != lights[3]) {
+				ivec3 pos(x, y, z);
+				greedyQuad(pos, pos, normal, axisX, axisY, region, lights);
+				continue;
+			}
+			greedy_face& face = greedyFaces[index];
+			face.region = region;
+			face.light = lights[0];
+			face.axisX = direction_index(axisX);
+			face.axisY = direction_index(axisY);
+		}
+
+		// a - normal axis, u and v - slice axes
+		const int a = normal.x ? 0 : (normal.y ? 1 : 2);
+		const int ua = a == 0 ? 2 : 0;
+		const int va = a == 1 ? 2 : 1;
+		for (uint index : greedyBlocks) {
+			const greedy_face face = greedyFaces[index];
+			if (face.region == NO_REGION)
+				continue;
+			ivec3 from (index % CHUNK_W, index / (CHUNK_W * CHUNK_D), index / CHUNK_W % CHUNK_D);
+			const int ulimit = sizes[ua] - from[ua];
+			const int vlimit = sizes[va] - from[va];
+			int w = 1;
+			while (w < ulimit && greedyFaces[index + w * steps[ua]].merges(face)) {
+				w++;
+			}
+			int h = 1;
+			for (; h < vlimit; h++) {
+				const uint row = index + h * steps[va];
+				int i = 0;
+				while (i < w && greedyFaces[row + i * steps[ua]].merges(face)) {
+					i++;
+				}
+				if (i < w)
+					break;
+			}
+			for (int dv = 0; dv < h; dv++) {
+				for (int du = 0; du < w; du++) {
+					greedyFaces[index + dv * steps[va] + du * steps[ua]].region = NO_REGION;
+				}
+			}
+			ivec3 to = from;
+			to[ua] += w - 1;
+			to[va] += h - 1;
+			const uint32_t lights[4] {face.light, face.light, face.light, face.light};
+			greedyQuad(from, to, normal, DIRECTIONS[face.axisX], DIRECTIONS[face.axisY], 
+					   face.region, lights);
+		}
 	}
-	return !id;
+}
+
+/* Add quad covering full blocks faces from..to (inclusive)
+   @param lights packed lights of corners */
+void BlocksRenderer::greedyQuad(const ivec3& from, const ivec3& to, 
+								const ivec3& normal, 
+								const ivec3& axisX, 
+								const ivec3& axisY, 
+								uint region, 
+								const uint32_t(&lights)[4]) {
+	reserveQuad();
+	const vec3 size(to - from);
+	// quad size in blocks along face axes
+	const float w = std::abs(glm::dot(size, vec3(axisX))) + 1.0f;
+	const float h = std::abs(glm::dot(size, vec3(axisY))) + 1.0f;
+	const vec3 X = vec3(axisX) * w;
+	const vec3 Y = vec3(axisY) * h;
+	const vec3 Z(normal);
+	const vec3 coord = (vec3(from) + vec3(to)) * 0.5f;
+	vertex(coord + (-X - Y + Z) * 0.5f, 0.0f, 0.0f, lights[0], region);
+	vertex(coord + ( X - Y + Z) * 0.5f, w, 0.0f, lights[1], region);
+	vertex(coord + ( X + Y + Z) * 0.5f, w, h, lights[2], region);
+	vertex(coord + (-X + Y + Z) * 0.5f, 0.0f, h, lights[3], region);
+	index(0, 1, 2, 0, 2, 3);
 }
 
 bool BlocksRenderer::isOpenForLight(int x, int y, int z) const {
-	blockid_t id = voxelsBuffer->pickBlockId(chunk->x * CHUNK_W + x, 
+	blockid_t id = voxelsBuffer->pickBlockId(offsetX + x, 
 											 y, 
-											 chunk->z * CHUNK_D + z);
+											 offsetZ + z);
 	if (id == BLOCK_VOID)
 		return false;
 	const Block& block = *blockDefsCache[id];
@@ -358,9 +563,17 @@ bool BlocksRenderer::isOpenForLight(int x, int y, int z) const {
 
 vec4 BlocksRenderer::pickLight(int x, int y, int z) const {
 	if (isOpenForLight(x, y, z)) {
-		light_t light = voxelsBuffer->pickLight(chunk->x * CHUNK_W + x, 
+		light_t light = voxelsBuffer->pickLight(offsetX + x, 
 												y, 
-												chunk->z * CHUNK_D + z);
+												offsetZ + z);
+		if (settings.graphics.backlight) {
+			light = Lightmap::combine(
+				std::min(15, Lightmap::extract(light, 0)+1),
+				std::min(15, Lightmap::extract(light, 1)+1),
+				std::min(15, Lightmap::extract(light, 2)+1),
+				Lightmap::extract(light, 3)
+			);
+		}
 		return vec4(Lightmap::extract(light, 0) / 15.0f,
 			Lightmap::extract(light, 1) / 15.0f,
 			Lightmap::extract(light, 2) / 15.0f,
@@ -375,9 +588,31 @@ vec4 BlocksRenderer::pickLight(const ivec3& coord) const {
 	return pickLight(coord.x, coord.y, coord.z);
 }
 
+/* @return index of the axis if vector is unit axis vector, else -1 */
+inline int unit_axis(const ivec3& v) {
+	if (v.y == 0 && v.z == 0 && (v.x == 1 || v.x == -1)) return 0;
+	if (v.x == 0 && v.z == 0 && (v.y == 1 || v.y == -1)) return 1;
+	if (v.x == 0 && v.y == 0 && (v.z == 1 || v.z == -1)) return 2;
+	return -1;
+}
+
 vec4 BlocksRenderer::pickSoftLight(const ivec3& coord, 
 								   const ivec3& right, 
 								   const ivec3& up) const {
+	int rightAxis = unit_axis(right);
+	int upAxis = unit_axis(up);
+	if (rightAxis >= 0 && upAxis >= 0 && rightAxis != upAxis) {
+		// corner is between voxels c-1 and c on right and up axes
+		int corner[3] {coord.x, coord.y, coord.z};
+		if (right[rightAxis] < 0) corner[rightAxis]++;
+		if (up[upAxis] < 0) corner[upAxis]++;
+		uint32_t light;
+		if (cornerLights->getCorner(3 - rightAxis - upAxis, 
+									corner[0], corner[1], corner[2], light)) {
+			return vec4(light & 0xFF, (light >> 8) & 0xFF, 
+						(light >> 16) & 0xFF, light >> 24) * (1.0f / 60.0f);
+		}
+	}
 	return (
 		pickLight(coord) +
 		pickLight(coord - right) +
@@ -391,36 +626,46 @@ vec4 BlocksRenderer::pickSoftLight(float x, float y, float z,
 	return pickSoftLight({int(round(x)), int(round(y)), int(round(z))}, right, up);
 }
 
-void BlocksRenderer::render(const voxel* voxels) {
-	int begin = chunk->bottom * (CHUNK_W * CHUNK_D);
-	int end = chunk->top * (CHUNK_W * CHUNK_D);
-	for (const auto drawGroup : *content->drawGroups) {
-		for (int i = begin; i < end; i++) {
-			const voxel& vox = voxels[i];
-			blockid_t id = vox.id;
-			const Block& def = *blockDefsCache[id];
-			if (id == 0 || def.drawGroup != drawGroup)
-				continue;
-			const UVRegion texfaces[6]{ cache->getRegion(id, 0), 
-										cache->getRegion(id, 1),
-										cache->getRegion(id, 2), 
-										cache->getRegion(id, 3),
-										cache->getRegion(id, 4), 
-										cache->getRegion(id, 5)};
+/* Blocks are bucketed by draw groups in one pass over the layers,
+   then buckets are meshed in draw groups order */
+void BlocksRenderer::render(const voxel* voxels, int bottom, int top) {
+	for (int i = bottom * CHUNK_W * CHUNK_D; i < top * CHUNK_W * CHUNK_D; i++) {
+		int x = i % CHUNK_W;
+		int y = i / (CHUNK_D * CHUNK_W);
+		int z = (i / CHUNK_D) % CHUNK_W;
+		// voxels are padded by one voxel on X and Z
+		blockid_t id = voxels[vox_index(x + 1, y, z + 1, CHUNK_W + 2, CHUNK_D + 2)].id;
+		const block_props& props = blockProps[id];
+		if (id == 0 || props.groupIndex == NO_GROUP)
+			continue;
+		if (props.model == BlockModel::block && faceMasks[i] == 0)
+			continue;
+		groupsBlocks[props.groupIndex].push_back(i);
+	}
+	for (auto& blocks : groupsBlocks) {
+		for (uint i : blocks) {
 			int x = i % CHUNK_W;
 			int y = i / (CHUNK_D * CHUNK_W);
 			int z = (i / CHUNK_D) % CHUNK_W;
+			const voxel& vox = voxels[vox_index(x + 1, y, z + 1, CHUNK_W + 2, CHUNK_D + 2)];
+			blockid_t id = vox.id;
+			const Block& def = *blockDefsCache[id];
 			switch (def.model) {
 			case BlockModel::block:
-                blockCube(x, y, z, texfaces, &def, vox.states, !def.rt.emissive);
+				if (settings.graphics.greedyMeshing) {
+					greedyBlocks.push_back(i);
+				} else {
+					blockCube(x, y, z, cache->getRegionIndices(id), &def, vox.states, !def.rt.emissive);
+				}
 				break;
 			case BlockModel::xsprite: {
+				const uint* texfaces = cache->getRegionIndices(id);
 				blockXSprite(x, y, z, vec3(1.0f), 
 							 texfaces[FACE_MX], texfaces[FACE_MZ], 1.0f);
 				break;
 			}
 			case BlockModel::aabb: {
-				blockAABB(ivec3(x,y,z), texfaces, &def, vox.rotation(), !def.rt.emissive);
+				blockAABB(ivec3(x,y,z), cache->getRegionIndices(id), &def, vox.rotation(), !def.rt.emissive);
 				break;
 			}
 			case BlockModel::custom: {
@@ -430,28 +675,86 @@ void BlocksRenderer::render(const voxel* voxels) {
 			default:
 				break;
 			}
-			if (overflow)
-				return;
+		}
+		blocks.clear();
+		if (!greedyBlocks.empty()) {
+			blockCubesGreedy();
+			greedyBlocks.clear();
 		}
 	}
 }
 
-Mesh* BlocksRenderer::render(const Chunk* chunk, const ChunksStorage* chunks) {
-	this->chunk = chunk;
-	voxelsBuffer->setPosition(chunk->x * CHUNK_W - 1, 0, chunk->z * CHUNK_D - 1);
-	chunks->getVoxels(voxelsBuffer, settings.graphics.backlight);
-	overflow = false;
+/* Voxels of layers bottom-1..top are converted to open codes first,
+   then every block of bottom..top-1 layers gets bits of directions
+   (DIRECTIONS order) in which its neighbours are open for its group.
+   Layers out of the chunk are closed as void */
+void BlocksRenderer::buildFaceMasks(const VoxelsVolume* volume, int bottom, int top) {
+	const int w = volume->getW();
+	const int d = volume->getD();
+	const int layer = (CHUNK_W + 2) * (CHUNK_D + 2);
+	const voxel* voxels = volume->getVoxels();
+	for (int y = bottom - 1; y <= top; y++) {
+		uint16_t* dst = openCodes.get() + (y + 1) * layer;
+		if (y < 0 || y >= CHUNK_H) {
+			std::fill(dst, dst + layer, OPEN_NONE);
+			continue;
+		}
+		const voxel* src = voxels + vox_index(0, y, 0, w, d);
+		for (int i = 0; i < layer; i++) {
+			blockid_t id = src[i].id;
+			dst[i] = id == BLOCK_VOID ? OPEN_NONE : blockProps[id].openCode;
+		}
+	}
+
+	const int row = CHUNK_W + 2;
+	for (int y = bottom; y < top; y++) {
+		for (int z = 0; z < CHUNK_D; z++) {
+			const voxel* src = voxels + vox_index(1, y, z + 1, w, d);
+			const uint16_t* codes = openCodes.get() + (y + 1) * layer + (z + 1) * row + 1;
+			ubyte* masks = faceMasks.get() + (y * CHUNK_D + z) * CHUNK_W;
+			for (int x = 0; x < CHUNK_W; x++) {
+				blockid_t id = src[x].id;
+				if (id == 0) {
+					masks[x] = 0;
+					continue;
+				}
+				const uint16_t group = blockProps[id].drawGroup;
+				const uint16_t* c = codes + x;
+				masks[x] = is_open(c[1], group) | 
+						   is_open(c[-1], group) << 1 |
+						   is_open(c[layer], group) << 2 | 
+						   is_open(c[-layer], group) << 3 |
+						   is_open(c[row], group) << 4 | 
+						   is_open(c[-row], group) << 5;
+			}
+		}
+	}
+}
+
+void BlocksRenderer::render(const VoxelsVolume* voxels, 
+							int bottom, int top, 
+							MeshData& data) {
+	voxelsBuffer = voxels;
+	offsetX = voxels->getX() + 1;
+	offsetZ = voxels->getZ() + 1;
+	cornerLights->build(voxels, blockDefsCache, bottom, top, 
+						settings.graphics.backlight);
+	buildFaceMasks(voxels, bottom, top);
+
+	// reused buffers keep their size, they are resized by grow() only
+	mesh = &data;
+	mesh->vertexSize = VERTEX_SIZE;
+	vertexBuffer = mesh->vertices.data();
+	indexBuffer = mesh->indices.data();
 	vertexOffset = 0;
 	indexOffset = indexSize = 0;
-	const voxel* voxels = chunk->voxels;
-	render(voxels);
+	render(voxels->getVoxels(), bottom, top);
 
-	const vattr attrs[]{ {3}, {2}, {1}, {0} };
-	size_t vcount = vertexOffset / BlocksRenderer::VERTEX_SIZE;
-	Mesh* mesh = new Mesh(vertexBuffer, vcount, indexBuffer, indexSize, attrs);
-	return mesh;
-}
+	mesh->verticesCount = vertexOffset / VERTEX_SIZE;
+	mesh->indicesCount = indexSize;
+	mesh = nullptr;
 
-VoxelsVolume* BlocksRenderer::getVoxelsBuffer() const {
-	return voxelsBuffer;
+	const size_t built = indexSize / 6;
+	size_t max = maxQuads;
+	while (built > max && !maxQuads.compare_exchange_weak(max, built));
 }
@@ -3,54 +3,117 @@
 
 #include <stdlib.h>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <glm/glm.hpp>
-#include "UVRegion.h"
+#include "MeshData.h"
 #include "../typedefs.h"
 #include "../voxels/voxel.h"
 #include "../settings.h"
 
 class Content;
-class Mesh;
 class Block;
-class Chunk;
-class Chunks;
+enum class BlockModel;
 class VoxelsVolume;
-class ChunksStorage;
 class ContentGfxCache;
+class CornerLights;
 
+/* Builds chunks meshes data on CPU. Uses no GL and no shared state,
+   so every worker thread may use its own renderer.
+   Vertex is 3 packed uint32: quantized position, atlas region index,
+   texture coordinates in tiles and light (see packVertex) */
 class BlocksRenderer {
-    static const glm::vec3 SUN_VECTOR;
-	static const uint VERTEX_SIZE;
 	const Content* const content;
-	float* vertexBuffer;
-	int* indexBuffer;
+	/* mesh data being built, its buffers are used as is and grow
+	   when full */
+	MeshData* mesh = nullptr;
+	uint32_t* vertexBuffer = nullptr;
+	int* indexBuffer = nullptr;
 	size_t vertexOffset;
 	size_t indexOffset, indexSize;
-	size_t capacity;
 
-	bool overflow = false;
+	/* world coordinates of the current chunk origin */
+	int offsetX = 0;
+	int offsetZ = 0;
+	/* current chunk voxels with one voxel padding on X and Z */
+	const VoxelsVolume* voxelsBuffer = nullptr;
+	/* Soft lights of the current chunk voxels corners */
+	CornerLights* cornerLights;
+
+	static const uint NO_REGION = ~0U;
+
+	/* Full block face for greedy meshing */
+	struct greedy_face {
+		/* atlas region index, NO_REGION if there is no face */
+		uint region = NO_REGION;
+		/* packed light of all face corners */
+		uint32_t light;
+		/* face axes directions indices */
+		ubyte axisX;
+		ubyte axisY;
+
+		inline bool merges(const greedy_face& other) const {
+			return region == other.region && light == other.light &&
+				   axisX == other.axisX && axisY == other.axisY;
+		}
+	};
+	/* Faces of one direction by chunk voxel index, empty between uses */
+	std::vector<greedy_face> greedyFaces;
+	/* Full blocks of the current draw group (voxel indices) */
+	std::vector<uint> greedyBlocks;
+
+	static const ubyte NO_GROUP = 0xFF;
 
-	const Chunk* chunk = nullptr;
-	VoxelsVolume* voxelsBuffer;
+	/* Block properties used before block definition is needed */
+	struct block_props {
+		/* OPEN_ALL, OPEN_NONE or draw group of light passing block */
+		uint16_t openCode;
+		ubyte drawGroup;
+		/* index of the draw group in draw groups order or NO_GROUP */
+		ubyte groupIndex;
+		BlockModel model;
+	};
+	std::vector<block_props> blockProps;
+	/* Blocks (voxel indices) to mesh by draw groups order */
+	std::vector<std::vector<uint>> groupsBlocks;
+	/* Open codes of padded voxels of mesh layers and one layer around */
+	std::unique_ptr<uint16_t[]> openCodes;
+	/* Visible faces directions bits of chunk voxels */
+	std::unique_ptr<ubyte[]> faceMasks;
 
 	const Block* const* blockDefsCache;
 	const ContentGfxCache* const cache;
 	const EngineSettings& settings;
 
-	void vertex(const glm::vec3& coord, float u, float v, const glm::vec4& light);
+	void grow();
+	/* Make sure buffers have space for one more quad */
+	inline void reserveQuad() {
+		if (indexSize + 6 > mesh->indices.size() ||
+			vertexOffset + VERTEX_SIZE * 4 > mesh->vertices.size()) {
+			grow();
+		}
+	}
+
+	void vertex(const glm::vec3& coord, float u, float v, uint32_t light, uint region);
+	void vertex(const glm::vec3& coord, float u, float v, const glm::vec4& light, uint region);
 	void index(int a, int b, int c, int d, int e, int f);
 
 	void vertex(const glm::vec3& coord, float u, float v, 
 				const glm::vec4& brightness,
 				const glm::vec3& axisX,
 				const glm::vec3& axisY,
-				const glm::vec3& axisZ);
+				const glm::vec3& axisZ,
+				uint region);
+	glm::vec4 vertexLight(const glm::vec3& coord,
+						  const glm::vec3& axisX,
+						  const glm::vec3& axisY,
+						  const glm::vec3& axisZ) const;
 
 	void face(const glm::vec3& coord, float w, float h, float d,
 		const glm::vec3& axisX,
 		const glm::vec3& axisY,
         const glm::vec3& axisZ,
-		const UVRegion& region,
+		uint region,
 		const glm::vec4(&lights)[4],
 		const glm::vec4& tint);
 	
@@ -58,7 +121,7 @@ class BlocksRenderer {
 		const glm::vec3& axisX,
 		const glm::vec3& axisY,
 		const glm::vec3& axisZ,
-		const UVRegion& region,
+		uint region,
         bool lights);
 
 	void tetragonicFace(const glm::vec3& coord,
@@ -67,34 +130,63 @@ class BlocksRenderer {
 		const glm::vec3& X,
 		const glm::vec3& Y,
 		const glm::vec3& Z,
-		const UVRegion& texreg,
+		uint texreg,
 		bool lights);
 	
-	void blockCube(int x, int y, int z, const UVRegion(&faces)[6], const Block* block, ubyte states, bool lights);
+	void blockCube(int x, int y, int z, const uint* faces, const Block* block, ubyte states, bool lights);
+	/* Full blocks faces of the draw group merged to larger quads */
+	void blockCubesGreedy();
+	void greedyQuad(const glm::ivec3& from, const glm::ivec3& to,
+					const glm::ivec3& normal,
+					const glm::ivec3& axisX,
+					const glm::ivec3& axisY,
+					uint region,
+					const uint32_t(&lights)[4]);
 	void blockAABB(const glm::ivec3& coord,
-                    const UVRegion(&faces)[6], 
+                    const uint* faces, 
                     const Block* block, 
                     ubyte rotation,
                     bool lights);
-	void blockXSprite(int x, int y, int z, const glm::vec3& size, const UVRegion& face1, const UVRegion& face2, float spread);
+	void blockXSprite(int x, int y, int z, const glm::vec3& size, uint face1, uint face2, float spread);
 	void blockCustomModel(const glm::ivec3& icoord,
 		const Block* block, ubyte rotation,
 		bool lights);
 
 	bool isOpenForLight(int x, int y, int z) const;
-	bool isOpen(int x, int y, int z, ubyte group) const;
+	void buildFaceMasks(const VoxelsVolume* volume, int bottom, int top);
 
 	glm::vec4 pickLight(int x, int y, int z) const;
 	glm::vec4 pickLight(const glm::ivec3& coord) const;
 	glm::vec4 pickSoftLight(const glm::ivec3& coord, const glm::ivec3& right, const glm::ivec3& up) const;
 	glm::vec4 pickSoftLight(float x, float y, float z, const glm::ivec3& right, const glm::ivec3& up) const;
-	void render(const voxel* voxels);
+	void render(const voxel* voxels, int bottom, int top);
 public:
-	BlocksRenderer(size_t capacity, const Content* content, const ContentGfxCache* cache, const EngineSettings& settings);
+	/* uint32 components per vertex */
+	static const uint VERTEX_SIZE;
+    /* Direction faces shading is calculated with */
+    static const glm::vec3 SUN_VECTOR;
+
+	/* Pack chunk mesh vertex to 3 uint32
+	   @param coord position relative to chunk, in -8..24 range for x and z
+	   @param u,v texture coordinates in tiles, whole numbers up to 511
+	   @param light packed light (R, G, B, S bytes from the highest one)
+	   @param region atlas region index in ContentGfxCache */
+	static void packVertex(uint32_t* dst, const glm::vec3& coord, 
+						   float u, float v, uint32_t light, uint region);
+
+	/* Telemetry: mesh buffers growths count and the largest mesh quads */
+	static std::atomic<uint> buffersGrowths;
+	static std::atomic<size_t> maxQuads;
+
+	BlocksRenderer(const Content* content, const ContentGfxCache* cache, const EngineSettings& settings);
 	virtual ~BlocksRenderer();
 
-	Mesh* render(const Chunk* chunk, const ChunksStorage* chunks);
-	VoxelsVolume* getVoxelsBuffer() const;
+	/* Build chunk mesh data
+	   @param voxels chunk voxels with one voxel padding on X and Z,
+	   filled with ChunksStorage::getVoxels (layers bottom-1..top at least)
+	   @param bottom,top range of chunk layers containing blocks
+	   @param data mesh data to replace, its buffers are reused */
+	void render(const VoxelsVolume* voxels, int bottom, int top, MeshData& data);
 };
 
 #endif // GRAPHICS_BLOCKS_RENDERER_H
\ No newline at end of file
@@ -1,52 +1,243 @@
 #include "ChunksRenderer.h"
 
 #include "Mesh.h"
+#include "MeshData.h"
+#include "MeshCache.h"
 #include "BlocksRenderer.h"
 #include "../voxels/Chunk.h"
+#include "../voxels/VoxelsVolume.h"
+#include "../files/WorldFiles.h"
 #include "../world/Level.h"
+#include "../world/World.h"
 
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
 using glm::ivec2;
 using std::shared_ptr;
 
-ChunksRenderer::ChunksRenderer(Level* level, const ContentGfxCache* cache, const EngineSettings& settings) : level(level) {
-	const int MAX_FULL_CUBES = 3000;
-	renderer = new BlocksRenderer(9 * 6 * 6 * MAX_FULL_CUBES, level->content, cache, settings);
+/* Meshes uploaded to GPU per frame, others wait for the next frame */
+const size_t MAX_UPLOADS_PER_FRAME = 8;
+/* Jobs per worker, jobs hold copied voxels so their number is limited */
+const size_t JOBS_PER_WORKER = 4;
+/* Each worker holds a full blocks renderer buffers */
+const uint MAX_WORKERS = 4;
+
+ChunksRenderer::ChunksRenderer(Level* level, const ContentGfxCache* cache, const EngineSettings& settings) 
+	: level(level), settings(settings) {
+	WorldFiles* wfile = level->getWorld()->wfile;
+	if (settings.graphics.meshCache && wfile) {
+		meshCache = std::make_unique<MeshCache>(
+			wfile->directory/fs::path("meshcache"),
+			level->content, cache, settings, BlocksRenderer::VERTEX_SIZE);
+	}
+	uint threads = std::thread::hardware_concurrency();
+	// main thread is busy enough
+	threads = std::max(1U, std::min(MAX_WORKERS, threads > 1 ? threads - 1 : 1));
+	for (uint i = 0; i < threads; i++) {
+		renderers.push_back(std::make_unique<BlocksRenderer>(
+			level->content, cache, settings));
+		connectivities.push_back(std::make_unique<SectionConnectivity>(level->content));
+	}
+	for (uint i = 0; i < threads; i++) {
+		workers.emplace_back(&ChunksRenderer::work, this, 
+							 renderers[i].get(), connectivities[i].get());
+	}
 }
 
 ChunksRenderer::~ChunksRenderer() {
-	delete renderer;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	jobsCondition.notify_all();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+}
+
+void ChunksRenderer::work(BlocksRenderer* renderer, SectionConnectivity* connectivity) {
+	while (true) {
+		std::unique_ptr<mesh_job> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobsCondition.wait(lock, [this]() {
+				return stopped || !jobs.empty();
+			});
+			if (stopped)
+				return;
+			// the last scheduled job is of the nearest chunk
+			job = std::move(jobs.back());
+			jobs.pop_back();
+		}
+		for (int section = job->sectionBottom; section < job->sectionTop; section++) {
+			MeshData& data = *job->data[section - job->sectionBottom];
+			int bottom = std::max(job->bottom, section * MESH_SECTION_H);
+			int top = std::min(job->top, (section + 1) * MESH_SECTION_H);
+			job->connectivity[section - job->sectionBottom] = connectivity->build(
+				job->voxels.get(), section * MESH_SECTION_H, (section + 1) * MESH_SECTION_H, 
+				job->bottom, job->top);
+			if (bottom >= top) {
+				data.clear();
+			} else if (meshCache) {
+				uint64_t hash = MeshCache::hashSection(job->voxels.get(), bottom, top);
+				if (!meshCache->get(job->key.x, job->key.y, section, hash, data)) {
+					renderer->render(job->voxels.get(), bottom, top, data);
+					meshCache->put(job->key.x, job->key.y, section, hash, data);
+				}
+			} else {
+				renderer->render(job->voxels.get(), bottom, top, data);
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		results.push_back(std::move(job));
+	}
 }
 
-shared_ptr<Mesh> ChunksRenderer::render(Chunk* chunk) {
+std::unique_ptr<ChunksRenderer::mesh_job> ChunksRenderer::makeJob(ivec2 key) {
+	shared_ptr<Chunk> chunk = level->chunksStorage->get(key.x, key.y);
+	if (chunk == nullptr || !chunk->isLighted() || pending.find(key) != pending.end())
+		return nullptr;
+
+	auto job = std::make_unique<mesh_job>();
+	job->key = key;
+	job->id = nextJobId++;
+	if (meshes.find(key) == meshes.end()) {
+		job->sectionBottom = 0;
+		job->sectionTop = MESH_SECTIONS;
+	} else {
+		// faces and soft lights of blocks next to modified layers change too
+		int bottom = std::max(chunk->modifiedBottom - 1, 0);
+		int top = std::min(chunk->modifiedTop + 1, CHUNK_H);
+		job->sectionBottom = bottom / MESH_SECTION_H;
+		job->sectionTop = (top + MESH_SECTION_H - 1) / MESH_SECTION_H;
+	}
 	chunk->setModified(false);
-	Mesh* mesh = renderer->render(chunk, level->chunksStorage);
-	auto sptr = shared_ptr<Mesh>(mesh);
-	meshes[ivec2(chunk->x, chunk->z)] = sptr;
-	return sptr;
+	if (buffers.empty()) {
+		job->voxels = std::make_unique<VoxelsVolume>(CHUNK_W + 2, CHUNK_H, CHUNK_D + 2);
+	} else {
+		job->voxels = std::move(buffers.back());
+		buffers.pop_back();
+	}
+	job->connectivity.resize(job->sectionTop - job->sectionBottom);
+	for (int i = job->sectionBottom; i < job->sectionTop; i++) {
+		if (meshBuffers.empty()) {
+			job->data.push_back(std::make_unique<MeshData>(BlocksRenderer::VERTEX_SIZE));
+		} else {
+			job->data.push_back(std::move(meshBuffers.back()));
+			meshBuffers.pop_back();
+		}
+	}
+	job->voxels->setPosition(chunk->x * CHUNK_W - 1, 0, chunk->z * CHUNK_D - 1);
+	job->bottom = chunk->bottom;
+	job->top = chunk->top;
+	// only layers read to mesh the sections (one layer around) are copied
+	int bottom = std::max(job->bottom, job->sectionBottom * MESH_SECTION_H);
+	int top = std::min(job->top, job->sectionTop * MESH_SECTION_H);
+	if (bottom < top) {
+		level->chunksStorage->getVoxels(job->voxels.get(), 
+			std::max(bottom - 1, 0), std::min(top + 1, CHUNK_H));
+	}
+	pending[key] = job->id;
+	return job;
+}
+
+void ChunksRenderer::upload(mesh_job* job) {
+	const vattr attrs[]{ {3, vattr_type::uint32}, {0} };
+	auto& mesh = meshes[job->key];
+	if (mesh == nullptr) {
+		mesh = std::make_shared<chunk_mesh>();
+		mesh->connectivity.fill(CONNECTED_ALL);
+	}
+	for (int section = job->sectionBottom; section < job->sectionTop; section++) {
+		const MeshData& data = *job->data[section - job->sectionBottom];
+		mesh->connectivity[section] = job->connectivity[section - job->sectionBottom];
+		auto& sectionMesh = mesh->sections[section];
+		if (data.indicesCount == 0) {
+			sectionMesh = nullptr;
+		} else {
+			sectionMesh = std::make_shared<Mesh>(
+				data.vertices.data(), data.getVerticesCount(), 
+				data.indices.data(), data.indicesCount, attrs);
+		}
+	}
+}
+
+void ChunksRenderer::update() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& job : results) {
+			ready.push_back(std::move(job));
+		}
+		results.clear();
+	}
+
+	size_t uploaded = 0;
+	size_t index = 0;
+	for (; index < ready.size() && uploaded < MAX_UPLOADS_PER_FRAME; index++) {
+		auto& job = ready[index];
+		auto found = pending.find(job->key);
+		if (found != pending.end() && found->second == job->id) {
+			upload(job.get());
+			pending.erase(found);
+			uploaded++;
+		}
+		buffers.push_back(std::move(job->voxels));
+		for (auto& data : job->data) {
+			meshBuffers.push_back(std::move(data));
+		}
+	}
+	ready.erase(ready.begin(), ready.begin() + index);
+
+	// requests are made from farthest to nearest chunk, jobs for the
+	// nearest ones are made and then scheduled nearest last
+	size_t limit = renderers.size() * JOBS_PER_WORKER;
+	std::vector<std::unique_ptr<mesh_job>> made;
+	for (auto it = requests.rbegin(); it != requests.rend(); it++) {
+		if (pending.size() >= limit)
+			break;
+		if (auto job = makeJob(*it)) {
+			made.push_back(std::move(job));
+		}
+	}
+	requests.clear();
+	if (made.empty())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto it = made.rbegin(); it != made.rend(); it++) {
+			jobs.push_back(std::move(*it));
+		}
+	}
+	jobsCondition.notify_all();
 }
 
 void ChunksRenderer::unload(Chunk* chunk) {
-	auto found = meshes.find(ivec2(chunk->x, chunk->z));
+	ivec2 key (chunk->x, chunk->z);
+	auto found = meshes.find(key);
 	if (found != meshes.end()) {
 		meshes.erase(found);
 	}
+	pending.erase(key);
 }
 
-shared_ptr<Mesh> ChunksRenderer::getOrRender(Chunk* chunk) {
-	auto found = meshes.find(ivec2(chunk->x, chunk->z));
-	if (found != meshes.end() && !chunk->isModified()){
-		return found->second;
+chunk_mesh* ChunksRenderer::getOrRender(Chunk* chunk) {
+	ivec2 key (chunk->x, chunk->z);
+	auto found = meshes.find(key);
+	if (found == meshes.end() || chunk->isModified()) {
+		requests.push_back(key);
 	}
-	return render(chunk);
+	if (found != meshes.end()) {
+		return found->second.get();
+	}
+	return nullptr;
 }
 
-shared_ptr<Mesh> ChunksRenderer::get(Chunk* chunk) {
+chunk_mesh* ChunksRenderer::get(Chunk* chunk) {
 	auto found = meshes.find(ivec2(chunk->x, chunk->z));
 	if (found != meshes.end()) {
-		return found->second;
+		return found->second.get();
 	}
 	return nullptr;
 }
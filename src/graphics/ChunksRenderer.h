@@ -1,35 +1,108 @@
 #ifndef SRC_GRAPHICS_CHUNKSRENDERER_H_
 #define SRC_GRAPHICS_CHUNKSRENDERER_H_
 
+#include <array>
+#include <mutex>
 #include <memory>
+#include <thread>
+#include <vector>
 #include <unordered_map>
+#include <condition_variable>
 #include <glm/glm.hpp>
+#include "../constants.h"
 #include "../voxels/Block.h"
 #include "../voxels/ChunksStorage.h"
 #include "../settings.h"
+#include "VisibilityGraph.h"
 
 class Mesh;
 class Chunk;
 class Level;
+class VoxelsVolume;
 class BlocksRenderer;
 class ContentGfxCache;
+class MeshCache;
+struct MeshData;
 
+/* Chunk layers per mesh section */
+const int MESH_SECTION_H = 16;
+const int MESH_SECTIONS = CHUNK_H / MESH_SECTION_H;
+
+/* Chunk mesh split to vertical sections, sections are rebuilt
+   only if they contain modified layers. Empty sections are nullptr */
+struct chunk_mesh {
+	std::array<std::shared_ptr<Mesh>, MESH_SECTIONS> sections;
+	/* Sections faces connectivity used for cave culling */
+	std::array<faces_connectivity, MESH_SECTIONS> connectivity;
+};
+
+/* Chunks meshes are built by worker threads from voxels copied
+   in the main thread, built meshes are uploaded by update() */
 class ChunksRenderer {
-	BlocksRenderer* renderer;
+	struct mesh_job {
+		glm::ivec2 key;
+		uint64_t id;
+		std::unique_ptr<VoxelsVolume> voxels;
+		int bottom, top;
+		/* sections to build [sectionBottom, sectionTop) */
+		int sectionBottom, sectionTop;
+		/* built sections data, indexed from sectionBottom */
+		std::vector<std::unique_ptr<MeshData>> data;
+		std::vector<faces_connectivity> connectivity;
+	};
+
 	Level* level;
-	std::unordered_map<glm::ivec2, std::shared_ptr<Mesh>> meshes;
+	const EngineSettings& settings;
+	std::unordered_map<glm::ivec2, std::shared_ptr<chunk_mesh>> meshes;
+	/* Ids of jobs building chunks meshes, results of other (cancelled)
+	   jobs are dropped */
+	std::unordered_map<glm::ivec2, uint64_t> pending;
+	uint64_t nextJobId = 1;
+	/* Chunks requested to be meshed in the current frame */
+	std::vector<glm::ivec2> requests;
+	/* Built meshes waiting for upload */
+	std::vector<std::unique_ptr<mesh_job>> ready;
+	/* Unused voxels buffers */
+	std::vector<std::unique_ptr<VoxelsVolume>> buffers;
+	/* Unused mesh data, its grown buffers are reused by next jobs */
+	std::vector<std::unique_ptr<MeshData>> meshBuffers;
+
+	/* Optional on-disk cache used by workers (nullptr if disabled) */
+	std::unique_ptr<MeshCache> meshCache;
+
+	/* One blocks renderer and connectivity builder per worker */
+	std::vector<std::unique_ptr<BlocksRenderer>> renderers;
+	std::vector<std::unique_ptr<SectionConnectivity>> connectivities;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable jobsCondition;
+	/* Guarded by mutex */
+	std::vector<std::unique_ptr<mesh_job>> jobs;
+	std::vector<std::unique_ptr<mesh_job>> results;
+	bool stopped = false;
+
+	/* Copy chunk voxels for a new mesh job
+	   @return nullptr if the chunk is not ready or already pending */
+	std::unique_ptr<mesh_job> makeJob(glm::ivec2 key);
+	void upload(mesh_job* job);
+	void work(BlocksRenderer* renderer, SectionConnectivity* connectivity);
 public:
 	ChunksRenderer(Level* level, 
 				   const ContentGfxCache* cache, 
 				   const EngineSettings& settings);
 	virtual ~ChunksRenderer();
 
-	std::shared_ptr<Mesh> render(Chunk* chunk);
 	void unload(Chunk* chunk);
 
-	std::shared_ptr<Mesh> getOrRender(Chunk* chunk);
-	std::shared_ptr<Mesh> get(Chunk* chunk);
+	/* @return current chunk mesh (may be outdated) or nullptr if not
+	   built yet. Modified sections of the mesh are requested to be rebuilt.
+	   Mesh is owned by the renderer and valid until update() or unload() */
+	chunk_mesh* getOrRender(Chunk* chunk);
+	chunk_mesh* get(Chunk* chunk);
 
+	/* Upload built meshes (limited per frame) and start building
+	   meshes requested in the previous frame */
+	void update();
 };
 
-#endif // SRC_GRAPHICS_CHUNKSRENDERER_H_
\ No newline at end of file
+#endif // SRC_GRAPHICS_CHUNKSRENDERER_H_
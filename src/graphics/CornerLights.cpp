@@ -0,0 +1,83 @@
+#include "CornerLights.h"
+
+#include <algorithm>
+#include "../voxels/Block.h"
+#include "../voxels/VoxelsVolume.h"
+
+CornerLights::CornerLights()
+    : voxels(new uint32_t[(CHUNK_W+2) * (CHUNK_H+2) * (CHUNK_D+2)]) {
+    corners[0].reset(new uint32_t[(CHUNK_W+2) * (CHUNK_H+2) * (CHUNK_D+1)]);
+    corners[1].reset(new uint32_t[(CHUNK_W+1) * (CHUNK_H+2) * (CHUNK_D+1)]);
+    corners[2].reset(new uint32_t[(CHUNK_W+1) * (CHUNK_H+2) * (CHUNK_D+2)]);
+}
+
+void CornerLights::build(const VoxelsVolume* volume,
+                         const Block* const* blockDefs,
+                         int bottom, int top, bool backlight) {
+    // faces of blocks in bottom..top-1 layers sample voxels one layer around
+    const int y1 = std::max(bottom-1, -1);
+    const int y2 = std::min(top, CHUNK_H);
+    this->bottom = y1;
+    this->top = y2;
+
+    const int w = volume->getW();
+    const int d = volume->getD();
+    const voxel* vvoxels = volume->getVoxels();
+    const light_t* vlights = volume->getLights();
+    for (int y = y1; y <= y2; y++) {
+        uint32_t* dst = voxels.get() + voxelIndex(-1, y, -1);
+        if (y < 0 || y >= CHUNK_H) {
+            std::fill(dst, dst + (CHUNK_W+2) * (CHUNK_D+2), 0);
+            continue;
+        }
+        for (int z = -1; z <= CHUNK_D; z++) {
+            for (int x = -1; x <= CHUNK_W; x++, dst++) {
+                size_t index = vox_index(x+1, y, z+1, w, d);
+                blockid_t id = vvoxels[index].id;
+                if (id == BLOCK_VOID || (id && !blockDefs[id]->lightPassing)) {
+                    *dst = 0;
+                } else if (backlight) {
+                    *dst = backlit(spread(vlights[index]));
+                } else {
+                    *dst = spread(vlights[index]);
+                }
+            }
+        }
+    }
+
+    // sums are up to 60 per channel, so bytes do not overflow
+    uint32_t* xcorners = corners[0].get();
+    for (int x = -1; x <= CHUNK_W; x++) {
+        for (int y = y1+1; y <= y2; y++) {
+            uint32_t* dst = xcorners + ((size_t)(x+1) * (CHUNK_H+2) + y+1) * (CHUNK_D+1);
+            const uint32_t* lo = voxels.get() + voxelIndex(x, y-1, -1);
+            const uint32_t* hi = voxels.get() + voxelIndex(x, y, -1);
+            for (int z = 0; z <= CHUNK_D; z++) {
+                const size_t step = CHUNK_W+2;
+                dst[z] = lo[z*step] + lo[(z+1)*step] + hi[z*step] + hi[(z+1)*step];
+            }
+        }
+    }
+    uint32_t* ycorners = corners[1].get();
+    for (int y = y1; y <= y2; y++) {
+        for (int z = 0; z <= CHUNK_D; z++) {
+            uint32_t* dst = ycorners + ((size_t)(y+1) * (CHUNK_D+1) + z) * (CHUNK_W+1);
+            const uint32_t* back = voxels.get() + voxelIndex(-1, y, z-1);
+            const uint32_t* front = voxels.get() + voxelIndex(-1, y, z);
+            for (int x = 0; x <= CHUNK_W; x++) {
+                dst[x] = back[x] + back[x+1] + front[x] + front[x+1];
+            }
+        }
+    }
+    uint32_t* zcorners = corners[2].get();
+    for (int z = -1; z <= CHUNK_D; z++) {
+        for (int y = y1+1; y <= y2; y++) {
+            uint32_t* dst = zcorners + ((size_t)(z+1) * (CHUNK_H+2) + y+1) * (CHUNK_W+1);
+            const uint32_t* lo = voxels.get() + voxelIndex(-1, y-1, z);
+            const uint32_t* hi = voxels.get() + voxelIndex(-1, y, z);
+            for (int x = 0; x <= CHUNK_W; x++) {
+                dst[x] = lo[x] + lo[x+1] + hi[x] + hi[x+1];
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef GRAPHICS_CORNERLIGHTS_H_
+#define GRAPHICS_CORNERLIGHTS_H_
+
+#include <memory>
+#include "../typedefs.h"
+#include "../constants.h"
+
+class Block;
+class VoxelsVolume;
+
+/* Chunk voxels lights and voxels corners soft lights precalculated
+   once per mesh building, so faces vertices just index them.
+   Light channels R, G, B, S are spread to bytes of uint32 (R is the
+   lowest one). Voxel light is 0 if the voxel does not pass light,
+   blocks backlight is added to lights of other voxels.
+   Corner light is a sum of 4 voxels lights around the corner in one
+   layer: corner on X layer at (x, y, z) sums voxels x; y-1..y; z-1..z.
+   Coordinates are chunk-local, voxels x and z in -1..CHUNK_W/D. */
+class CornerLights {
+    std::unique_ptr<uint32_t[]> voxels;
+    /* corners of X, Y and Z axis layers */
+    std::unique_ptr<uint32_t[]> corners[3];
+    /* calculated layers range */
+    int bottom = 0;
+    int top = 0;
+
+    static inline size_t voxelIndex(int x, int y, int z) {
+        return ((size_t)(y+1) * (CHUNK_D+2) + z+1) * (CHUNK_W+2) + x+1;
+    }
+public:
+    CornerLights();
+
+    /* @param volume chunk voxels with one voxel padding on X and Z
+       @param bottom chunk lowest not empty layer
+       @param top chunk highest not empty layer + 1
+       @param backlight add blocks backlight to R, G, B channels */
+    void build(const VoxelsVolume* volume, const Block* const* blockDefs,
+               int bottom, int top, bool backlight);
+
+    /* @param axis layer axis (0 - X, 1 - Y, 2 - Z)
+       @param light packed sum of 4 voxels lights around the corner
+       @return false if the corner is out of calculated range */
+    inline bool getCorner(int axis, int x, int y, int z, uint32_t& light) const {
+        // corner needs voxels layers y-1 and y, except Y layers ones
+        if (y > top || y < bottom + (axis != 1)) {
+            return false;
+        }
+        switch (axis) {
+            case 0:
+                if (x < -1 || x > CHUNK_W || z < 0 || z > CHUNK_D)
+                    return false;
+                light = corners[0][((size_t)(x+1) * (CHUNK_H+2) + y+1) * (CHUNK_D+1) + z];
+                return true;
+            case 1:
+                if (x < 0 || x > CHUNK_W || z < 0 || z > CHUNK_D)
+                    return false;
+                light = corners[1][((size_t)(y+1) * (CHUNK_D+1) + z) * (CHUNK_W+1) + x];
+                return true;
+            default:
+                if (x < 0 || x > CHUNK_W || z < -1 || z > CHUNK_D)
+                    return false;
+                light = corners[2][((size_t)(z+1) * (CHUNK_H+2) + y+1) * (CHUNK_W+1) + x];
+                return true;
+        }
+    }
+
+    static inline uint32_t spread(light_t light) {
+        return (light & 0xF) | ((light & 0xF0) << 4) |
+               ((light & 0xF00) << 8) | ((uint32_t)(light & 0xF000) << 12);
+    }
+
+    /* Add backlight to spread light: R, G, B are increased by 1
+       up to 15, S is not changed */
+    static inline uint32_t backlit(uint32_t light) {
+        light += 0x010101;
+        return light - ((light >> 4) & 0x010101);
+    }
+};
+
+#endif // GRAPHICS_CORNERLIGHTS_H_
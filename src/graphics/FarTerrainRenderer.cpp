@@ -0,0 +1,134 @@
+#include "FarTerrainRenderer.h"
+
+#include "Mesh.h"
+#include "BlocksRenderer.h"
+#include "../constants.h"
+#include "../voxels/FarTerrain.h"
+#include "../frontend/ContentGfxCache.h"
+
+using glm::vec3;
+
+const size_t FAR_VERTEX_SIZE = 3;
+// top face and up to 4 side faces per column
+const size_t FAR_MAX_FACES = CHUNK_W * CHUNK_D * 5;
+
+FarTerrainRenderer::FarTerrainRenderer(const FarTerrain* terrain,
+                                       const ContentGfxCache* cache)
+    : terrain(terrain),
+      cache(cache),
+      vertexBuffer(new uint32_t[FAR_MAX_FACES * 4 * FAR_VERTEX_SIZE]),
+      indexBuffer(new int[FAR_MAX_FACES * 6]) {
+}
+
+FarTerrainRenderer::~FarTerrainRenderer() {
+}
+
+void FarTerrainRenderer::vertex(const vec3& coord, float u, float v, 
+                                float light, uint region) {
+    // sky light only
+    uint32_t packed = uint32_t(light * 255) & 0xff;
+    BlocksRenderer::packVertex(vertexBuffer.get() + vertexOffset, 
+                               coord, u, v, packed, region);
+    vertexOffset += FAR_VERTEX_SIZE;
+}
+
+/* @param coord face center
+   @param Y face axis scaled by face height (in blocks) */
+void FarTerrainRenderer::face(const vec3& coord,
+                              const vec3& X,
+                              const vec3& Y,
+                              const vec3& Z,
+                              float height,
+                              blockid_t id,
+                              int side) {
+    uint region = cache->getRegionIndex(id, side);
+    float light = 0.7f + glm::dot(Z, BlocksRenderer::SUN_VECTOR) * 0.3f;
+
+    int offset = vertexOffset / FAR_VERTEX_SIZE;
+    vec3 Yh = Y * height;
+    vec3 p1 = coord + (-X - Yh) * 0.5f;
+    vec3 p2 = coord + ( X - Yh) * 0.5f;
+    vec3 p3 = coord + ( X + Yh) * 0.5f;
+    vec3 p4 = coord + (-X + Yh) * 0.5f;
+    // texture repeats along stretched sides
+    vertex(p1, 0.0f, 0.0f, light, region);
+    vertex(p2, 1.0f, 0.0f, light, region);
+    vertex(p3, 1.0f, height, light, region);
+    vertex(p4, 0.0f, height, light, region);
+
+    indexBuffer[indexSize++] = offset;
+    indexBuffer[indexSize++] = offset + 1;
+    indexBuffer[indexSize++] = offset + 2;
+    indexBuffer[indexSize++] = offset;
+    indexBuffer[indexSize++] = offset + 2;
+    indexBuffer[indexSize++] = offset + 3;
+}
+
+std::shared_ptr<Mesh> FarTerrainRenderer::render(std::shared_ptr<FarChunk> chunk) {
+    const vec3 X(1, 0, 0);
+    const vec3 Y(0, 1, 0);
+    const vec3 Z(0, 0, 1);
+
+    vertexOffset = 0;
+    indexSize = 0;
+    for (int z = 0; z < CHUNK_D; z++) {
+        for (int x = 0; x < CHUNK_W; x++) {
+            const surface_column& column = chunk->get(x, z);
+            if (column.id == BLOCK_AIR) {
+                continue;
+            }
+            int top = column.height + 1;
+            face(vec3(x + 0.5f, top, z + 0.5f), X, -Z, Y, 1.0f, column.id, 3);
+
+            // sides are stretched down to the neighbour column surface
+            const surface_column* neighbours[4] {
+                &chunk->get(x + 1, z), &chunk->get(x - 1, z),
+                &chunk->get(x, z + 1), &chunk->get(x, z - 1)
+            };
+            for (int i = 0; i < 4; i++) {
+                int bottom = neighbours[i]->height + 1;
+                if (bottom >= top) {
+                    continue;
+                }
+                float height = top - bottom;
+                float y = (top + bottom) * 0.5f;
+                switch (i) {
+                    case 0: face(vec3(x + 1, y, z + 0.5f), -Z, Y, X, height, column.id, 1); break;
+                    case 1: face(vec3(x, y, z + 0.5f), Z, Y, -X, height, column.id, 0); break;
+                    case 2: face(vec3(x + 0.5f, y, z + 1), X, Y, Z, height, column.id, 5); break;
+                    case 3: face(vec3(x + 0.5f, y, z), -X, Y, -Z, height, column.id, 4); break;
+                }
+            }
+        }
+    }
+    const vattr attrs[]{ {3, vattr_type::uint32}, {0} };
+    size_t vcount = vertexOffset / FAR_VERTEX_SIZE;
+    auto mesh = std::make_shared<Mesh>(
+        vertexBuffer.get(), vcount, indexBuffer.get(), indexSize, attrs
+    );
+    meshes[glm::ivec2(chunk->x, chunk->z)] = {chunk, mesh};
+    return mesh;
+}
+
+std::shared_ptr<Mesh> FarTerrainRenderer::get(const std::shared_ptr<FarChunk>& chunk) const {
+    auto found = meshes.find(glm::ivec2(chunk->x, chunk->z));
+    if (found == meshes.end() || found->second.source != chunk) {
+        return nullptr;
+    }
+    return found->second.mesh;
+}
+
+void FarTerrainRenderer::update() {
+    if (terrainVersion == terrain->getVersion()) {
+        return;
+    }
+    terrainVersion = terrain->getVersion();
+    for (auto it = meshes.begin(); it != meshes.end();) {
+        auto chunk = terrain->get(it->first.x, it->first.y);
+        if (chunk != it->second.source) {
+            it = meshes.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef GRAPHICS_FARTERRAINRENDERER_H_
+#define GRAPHICS_FARTERRAINRENDERER_H_
+
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "../typedefs.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+class Mesh;
+class FarChunk;
+class FarTerrain;
+class ContentGfxCache;
+
+/* Builds meshes of reduced detail terrain: top faces of columns and
+   side faces down to lower neighbour columns, lit by sky only.
+   Vertex format is the same as BlocksRenderer one */
+class FarTerrainRenderer {
+    struct far_mesh {
+        /* chunk mesh is built from, mesh is rebuilt if chunk replaced */
+        std::shared_ptr<FarChunk> source;
+        std::shared_ptr<Mesh> mesh;
+    };
+    const FarTerrain* const terrain;
+    const ContentGfxCache* const cache;
+    std::unordered_map<glm::ivec2, far_mesh> meshes;
+    uint terrainVersion = 0;
+
+    std::unique_ptr<uint32_t[]> vertexBuffer;
+    std::unique_ptr<int[]> indexBuffer;
+    size_t vertexOffset = 0;
+    size_t indexSize = 0;
+
+    void vertex(const glm::vec3& coord, float u, float v, float light, 
+                uint region);
+    void face(const glm::vec3& coord,
+              const glm::vec3& X,
+              const glm::vec3& Y,
+              const glm::vec3& Z,
+              float height,
+              blockid_t id,
+              int side);
+public:
+    FarTerrainRenderer(const FarTerrain* terrain, const ContentGfxCache* cache);
+    ~FarTerrainRenderer();
+
+    std::shared_ptr<Mesh> render(std::shared_ptr<FarChunk> chunk);
+
+    /* @return existing mesh or nullptr if not built or outdated */
+    std::shared_ptr<Mesh> get(const std::shared_ptr<FarChunk>& chunk) const;
+
+    /* Remove meshes of chunks removed from far terrain */
+    void update();
+};
+
+#endif // GRAPHICS_FARTERRAINRENDERER_H_
@@ -3,7 +3,7 @@
 
 int Mesh::meshesCount = 0;
 
-Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const vattr* attrs) : 
+Mesh::Mesh(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const vattr* attrs) : 
 	ibo(0),
 	vertices(vertices),
 	indices(indices)
@@ -23,7 +23,15 @@ Mesh::Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, s
 	int offset = 0;
 	for (int i = 0; attrs[i].size; i++) {
 		int size = attrs[i].size;
-		glVertexAttribPointer(i, size, GL_FLOAT, GL_FALSE, vertexSize * sizeof(float), (GLvoid*)(offset * sizeof(float)));
+		GLvoid* pointer = (GLvoid*)(offset * sizeof(float));
+		switch (attrs[i].type) {
+			case vattr_type::float32:
+				glVertexAttribPointer(i, size, GL_FLOAT, GL_FALSE, vertexSize * sizeof(float), pointer);
+				break;
+			case vattr_type::uint32:
+				glVertexAttribIPointer(i, size, GL_UNSIGNED_INT, vertexSize * sizeof(float), pointer);
+				break;
+		}
 		glEnableVertexAttribArray(i);
 		offset += size;
 	}
@@ -38,7 +46,7 @@ Mesh::~Mesh(){
 	if (ibo != 0) glDeleteBuffers(1, &ibo);
 }
 
-void Mesh::reload(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices){
+void Mesh::reload(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices){
 	glBindVertexArray(vao);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	if (vertexBuffer != nullptr && vertices != 0) {
@@ -4,8 +4,16 @@
 #include <stdlib.h>
 #include "../typedefs.h"
 
+enum class vattr_type {
+	float32,
+	/* read by shader as integers (uint, uvec2...) */
+	uint32
+};
+
+/* Vertex attribute of 4 bytes components */
 struct vattr {
 	ubyte size;
+	vattr_type type = vattr_type::float32;
 };
 
 class Mesh {
@@ -16,12 +24,12 @@ class Mesh {
 	size_t indices;
 	size_t vertexSize;
 public:
-	Mesh(const float* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const vattr* attrs);
-	Mesh(const float* vertexBuffer, size_t vertices, const vattr* attrs) :
+	Mesh(const void* vertexBuffer, size_t vertices, const int* indexBuffer, size_t indices, const vattr* attrs);
+	Mesh(const void* vertexBuffer, size_t vertices, const vattr* attrs) :
 		Mesh(vertexBuffer, vertices, nullptr, 0, attrs) {};
 	~Mesh();
 
-	void reload(const float* vertexBuffer, size_t vertices, const int* indexBuffer = nullptr, size_t indices = 0);
+	void reload(const void* vertexBuffer, size_t vertices, const int* indexBuffer = nullptr, size_t indices = 0);
 	void draw(unsigned int primitive);
 	void draw();
 
@@ -0,0 +1,366 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "MeshData.h"
+#include "ChunksRenderer.h"
+#include "../content/Content.h"
+#include "../frontend/ContentGfxCache.h"
+#include "../voxels/Block.h"
+#include "../voxels/VoxelsVolume.h"
+#include "../files/files.h"
+#include "../files/WorldFiles.h"
+#include "../coders/gzip.h"
+#include "../coders/byte_utils.h"
+#include "../maths/voxmaths.h"
+
+const size_t MESH_CACHE_HEADER_SIZE = 10;
+
+const uint64_t HASH_OFFSET = 14695981039346656037ULL;
+const uint64_t HASH_PRIME = 1099511628211ULL;
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+    const ubyte* bytes = (const ubyte*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * HASH_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const std::string& str) {
+    return hash_bytes(hash, str.c_str(), str.length() + 1);
+}
+
+/* Word at a time variant for large buffers */
+static uint64_t hash_words(uint64_t hash, const void* data, size_t size) {
+    const ubyte* bytes = (const ubyte*)data;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = (hash ^ word) * HASH_PRIME;
+        hash ^= hash >> 32;
+    }
+    return hash_bytes(hash, bytes + i, size - i);
+}
+
+/* Blocks properties used by BlocksRenderer. Vertices refer to
+   ContentGfxCache regions by index, indices depend on textures present
+   in the atlas, so they are hashed instead of textures names */
+static uint64_t hash_content(const Content* content, const ContentGfxCache* cache) {
+    uint64_t hash = HASH_OFFSET;
+    const Block* const* blockDefs = content->getIndices()->getBlockDefs();
+    size_t count = content->getIndices()->countBlockDefs();
+    for (size_t i = 0; i < count; i++) {
+        const Block* def = blockDefs[i];
+        hash = hash_string(hash, def->name);
+        hash = hash_bytes(hash, cache->getRegionIndices(i), 6 * sizeof(uint));
+        hash = hash_bytes(hash, cache->getModelRegions(i),
+                          def->modelTextures.size() * sizeof(uint));
+        for (const auto& box : def->modelBoxes) {
+            hash = hash_bytes(hash, &box, sizeof(AABB));
+        }
+        for (const auto& point : def->modelExtraPoints) {
+            hash = hash_bytes(hash, &point, sizeof(glm::vec3));
+        }
+        hash = hash_string(hash, def->rotations.name);
+        hash = hash_bytes(hash, &def->hitbox, sizeof(AABB));
+        ubyte props[] {
+            (ubyte)def->model,
+            def->drawGroup,
+            def->lightPassing,
+            def->rotatable,
+            def->rt.solid,
+            def->emission[0],
+            def->emission[1],
+            def->emission[2]
+        };
+        hash = hash_bytes(hash, props, sizeof(props));
+    }
+    return hash;
+}
+
+MeshCache::MeshCache(fs::path folder,
+                     const Content* content,
+                     const ContentGfxCache* cache,
+                     const EngineSettings& settings,
+                     uint vertexSize)
+    : folder(folder), vertexSize(vertexSize) {
+    salt = hash_content(content, cache);
+    ubyte flags[] {
+        settings.graphics.greedyMeshing,
+        settings.graphics.backlight,
+        (ubyte)vertexSize
+    };
+    salt = hash_bytes(salt, flags, sizeof(flags));
+}
+
+MeshCache::~MeshCache() {
+    write();
+}
+
+fs::path MeshCache::getRegionFile(int x, int z) const {
+    return folder/fs::path(std::to_string(x) + "_" + std::to_string(z) + ".bin");
+}
+
+MeshCache::region* MeshCache::getRegion(std::unique_lock<std::mutex>& lock, int x, int z) {
+    glm::ivec2 key(x, z);
+    while (true) {
+        auto found = regions.find(key);
+        if (found != regions.end()) {
+            found->second->lastUse = ++useCounter;
+            return found->second.get();
+        }
+        if (busy.find(key) == busy.end()) {
+            break;
+        }
+        // being loaded or written after eviction by other thread
+        ioCondition.wait(lock);
+    }
+    busy.insert(key);
+    lock.unlock();
+    auto loaded = readRegion(x, z);
+    lock.lock();
+    busy.erase(key);
+    ioCondition.notify_all();
+
+    region* reg = loaded.get();
+    reg->lastUse = ++useCounter;
+    bytes += reg->bytes;
+    regions[key] = std::move(loaded);
+    return reg;
+}
+
+std::unique_ptr<MeshCache::region> MeshCache::readRegion(int x, int z) const {
+    auto reg = std::make_unique<region>();
+    fs::path filename = getRegionFile(x, z);
+    if (!fs::is_regular_file(filename)) {
+        return reg;
+    }
+    // any failure drops the region, broken file is overwritten later
+    try {
+        size_t length;
+        std::unique_ptr<char[]> file (files::read_bytes(filename, length));
+        const ubyte* header = (const ubyte*)file.get();
+        if (length <= MESH_CACHE_HEADER_SIZE + 4 ||
+            std::memcmp(header, MESH_CACHE_MAGIC, 8) != 0 ||
+            header[8] != MESH_CACHE_FORMAT_VERSION) {
+            return reg;
+        }
+        // gzip footer holds uncompressed size, decompress allocates it
+        uint32_t size;
+        std::memcpy(&size, header + length - 4, sizeof(size));
+        if (size > MESH_CACHE_MAX_BYTES) {
+            throw std::runtime_error("invalid uncompressed size");
+        }
+        auto data = gzip::decompress(header + MESH_CACHE_HEADER_SIZE,
+                                     length - MESH_CACHE_HEADER_SIZE);
+        ByteReader reader(data.data(), data.size());
+        if ((uint64_t)reader.getInt64() != salt) {
+            // made for other content or settings
+            return reg;
+        }
+        uint count = reader.getInt32();
+        for (uint i = 0; i < count; i++) {
+            uint index = reader.getInt32();
+            entry& e = reg->entries[index];
+            e.hash = reader.getInt64();
+            uint32_t vertices = reader.getInt32();
+            uint32_t indices = reader.getInt32();
+            if ((uint64_t)vertices + indices > reader.remaining() / 4 ||
+                vertices % vertexSize) {
+                throw std::runtime_error("invalid entry size");
+            }
+            e.vertices.resize(vertices);
+            e.indices.resize(indices);
+            for (auto& component : e.vertices) {
+                component = reader.getInt32();
+            }
+            for (auto& vertex : e.indices) {
+                vertex = reader.getInt32();
+                if (vertex < 0 || (uint32_t)vertex >= vertices / vertexSize) {
+                    throw std::runtime_error("invalid vertex index");
+                }
+            }
+            reg->bytes += (e.vertices.size() + e.indices.size()) * 4;
+        }
+    } catch (const std::exception& err) {
+        std::cerr << "corrupted mesh cache file " << filename.u8string();
+        std::cerr << ": " << err.what() << std::endl;
+        reg->entries.clear();
+        reg->bytes = 0;
+    }
+    return reg;
+}
+
+std::vector<ubyte> MeshCache::serializeRegion(const region* reg) const {
+    size_t size = 12;
+    for (const auto& [index, e] : reg->entries) {
+        size += 20 + (e.vertices.size() + e.indices.size()) * 4;
+    }
+    ByteBuilder builder;
+    builder.reserve(size);
+    builder.putInt64(salt);
+    builder.putInt32(reg->entries.size());
+    for (const auto& [index, e] : reg->entries) {
+        builder.putInt32(index);
+        builder.putInt64(e.hash);
+        builder.putInt32(e.vertices.size());
+        builder.putInt32(e.indices.size());
+        for (uint32_t component : e.vertices) {
+            builder.putInt32(component);
+        }
+        for (int vertex : e.indices) {
+            builder.putInt32(vertex);
+        }
+    }
+    return builder.build();
+}
+
+void MeshCache::writeRegion(int x, int z, const std::vector<ubyte>& data) const {
+    auto compressed = gzip::compress(data.data(), data.size());
+
+    std::vector<char> file(MESH_CACHE_HEADER_SIZE + compressed.size());
+    std::memcpy(file.data(), MESH_CACHE_MAGIC, 8);
+    file[8] = MESH_CACHE_FORMAT_VERSION;
+    file[9] = 0; // flags
+    std::memcpy(file.data() + MESH_CACHE_HEADER_SIZE, compressed.data(), compressed.size());
+
+    fs::create_directories(folder);
+    files::write_bytes(getRegionFile(x, z), file.data(), file.size());
+}
+
+void MeshCache::saveRegion(std::unique_lock<std::mutex>& lock, glm::ivec2 key, region* reg) {
+    if (!reg->unsaved) {
+        return;
+    }
+    // data is taken under the lock while the region is busy,
+    // so files are written in order of changes
+    auto data = serializeRegion(reg);
+    reg->unsaved = false;
+    lock.unlock();
+    try {
+        writeRegion(key.x, key.y, data);
+    } catch (const std::exception& err) {
+        std::cerr << "could not write mesh cache file: " << err.what() << std::endl;
+    }
+    lock.lock();
+}
+
+void MeshCache::evict(std::unique_lock<std::mutex>& lock) {
+    while (bytes > MESH_CACHE_MAX_BYTES) {
+        auto oldest = regions.end();
+        for (auto it = regions.begin(); it != regions.end(); it++) {
+            if (busy.find(it->first) == busy.end() &&
+                (oldest == regions.end() ||
+                 it->second->lastUse < oldest->second->lastUse)) {
+                oldest = it;
+            }
+        }
+        if (oldest == regions.end()) {
+            return;
+        }
+        glm::ivec2 key = oldest->first;
+        std::unique_ptr<region> reg = std::move(oldest->second);
+        regions.erase(oldest);
+        bytes -= reg->bytes;
+        // region file is read again only after it is written
+        busy.insert(key);
+        saveRegion(lock, key, reg.get());
+        busy.erase(key);
+        ioCondition.notify_all();
+    }
+}
+
+bool MeshCache::get(int x, int z, int section, uint64_t hash, MeshData& data) {
+    int regionX = floordiv(x, REGION_SIZE);
+    int regionZ = floordiv(z, REGION_SIZE);
+    uint index = ((z - regionZ * REGION_SIZE) * REGION_SIZE +
+                  (x - regionX * REGION_SIZE)) * MESH_SECTIONS + section;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    region* reg = getRegion(lock, regionX, regionZ);
+    auto found = reg->entries.find(index);
+    bool hit = found != reg->entries.end() && found->second.hash == hash;
+    if (hit) {
+        const entry& e = found->second;
+        if (data.vertices.size() < e.vertices.size()) {
+            data.vertices.resize(e.vertices.size());
+        }
+        if (data.indices.size() < e.indices.size()) {
+            data.indices.resize(e.indices.size());
+        }
+        std::copy(e.vertices.begin(), e.vertices.end(), data.vertices.begin());
+        std::copy(e.indices.begin(), e.indices.end(), data.indices.begin());
+        data.verticesCount = e.vertices.size() / data.vertexSize;
+        data.indicesCount = e.indices.size();
+    }
+    // the region may be unloaded now
+    evict(lock);
+    return hit;
+}
+
+void MeshCache::put(int x, int z, int section, uint64_t hash, const MeshData& data) {
+    int regionX = floordiv(x, REGION_SIZE);
+    int regionZ = floordiv(z, REGION_SIZE);
+    uint index = ((z - regionZ * REGION_SIZE) * REGION_SIZE +
+                  (x - regionX * REGION_SIZE)) * MESH_SECTIONS + section;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    region* reg = getRegion(lock, regionX, regionZ);
+    entry& e = reg->entries[index];
+    size_t oldBytes = (e.vertices.size() + e.indices.size()) * 4;
+    e.hash = hash;
+    e.vertices.assign(data.vertices.begin(),
+                      data.vertices.begin() + data.verticesCount * data.vertexSize);
+    e.indices.assign(data.indices.begin(), data.indices.begin() + data.indicesCount);
+    size_t newBytes = (e.vertices.size() + e.indices.size()) * 4;
+    reg->bytes += newBytes - oldBytes;
+    bytes += newBytes - oldBytes;
+    reg->unsaved = true;
+    evict(lock);
+}
+
+void MeshCache::write() {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<glm::ivec2> keys;
+    for (auto& [key, reg] : regions) {
+        if (reg->unsaved) {
+            keys.push_back(key);
+        }
+    }
+    for (glm::ivec2 key : keys) {
+        ioCondition.wait(lock, [this, key]() {
+            return busy.find(key) == busy.end();
+        });
+        auto found = regions.find(key);
+        if (found == regions.end()) {
+            // evicted and written meanwhile
+            continue;
+        }
+        busy.insert(key);
+        saveRegion(lock, key, found->second.get());
+        busy.erase(key);
+        ioCondition.notify_all();
+    }
+}
+
+uint64_t MeshCache::hashSection(const VoxelsVolume* volume, int bottom, int top) {
+    // faces and corner soft lights of layers bottom..top-1 depend on
+    // layers bottom-1..top
+    int y1 = std::max(bottom - 1, 0);
+    int y2 = std::min(top + 1, volume->getH());
+    size_t layer = (size_t)volume->getW() * volume->getD();
+    size_t offset = y1 * layer;
+    size_t count = (y2 - y1) * layer;
+
+    uint64_t hash = HASH_OFFSET;
+    int range[] {bottom, top};
+    hash = hash_bytes(hash, range, sizeof(range));
+    hash = hash_words(hash, volume->getVoxels() + offset, count * sizeof(voxel));
+    hash = hash_words(hash, volume->getLights() + offset, count * sizeof(light_t));
+    return hash;
+}
@@ -0,0 +1,115 @@
+#ifndef GRAPHICS_MESHCACHE_H_
+#define GRAPHICS_MESHCACHE_H_
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+
+#include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+#include "../typedefs.h"
+#include "../settings.h"
+
+class Content;
+class ContentGfxCache;
+class VoxelsVolume;
+struct MeshData;
+
+namespace fs = std::filesystem;
+
+#define MESH_CACHE_MAGIC ".VOXMSH"
+/* Increase when BlocksRenderer output for the same voxels changes */
+const uint MESH_CACHE_FORMAT_VERSION = 1;
+/* Chunks regions with meshes data are written to files and unloaded
+   (least recently used first) when cached data exceeds this size */
+const size_t MESH_CACHE_MAX_BYTES = 64 * 1024 * 1024;
+
+/* Chunks sections meshes data saved between sessions, so unchanged
+   chunks are not meshed again when they are loaded.
+   Entry is keyed by section position and by hash of the voxels and
+   lights the section mesh is built from (including neighbour chunks
+   borders), outdated entries are just replaced.
+   Data is stored in gzip compressed files per REGION_SIZE*REGION_SIZE
+   chunks. Files made for other content, atlas regions or meshing
+   settings are ignored.
+   Methods are thread-safe, files are read and written out of the lock,
+   so other regions are available meanwhile */
+class MeshCache {
+    struct entry {
+        uint64_t hash;
+        std::vector<uint32_t> vertices;
+        std::vector<int> indices;
+    };
+    struct region {
+        /* key is (local chunk index * MESH_SECTIONS + section) */
+        std::unordered_map<uint, entry> entries;
+        size_t bytes = 0;
+        uint64_t lastUse = 0;
+        bool unsaved = false;
+    };
+
+    fs::path folder;
+    /* hash of content and settings affecting meshes */
+    uint64_t salt;
+    uint vertexSize;
+    std::mutex mutex;
+    /* Guarded by mutex */
+    std::unordered_map<glm::ivec2, std::unique_ptr<region>> regions;
+    size_t bytes = 0;
+    uint64_t useCounter = 0;
+    /* Regions which files are being read or written without the lock,
+       other threads wait for ioCondition to access them */
+    std::unordered_set<glm::ivec2> busy;
+    std::condition_variable ioCondition;
+
+    /* Find or load region, the lock is released while file is read
+       @return region valid until the lock is released */
+    region* getRegion(std::unique_lock<std::mutex>& lock, int x, int z);
+    /* Read and decompress region file, called without the lock */
+    std::unique_ptr<region> readRegion(int x, int z) const;
+    /* Region data to be written by writeRegion */
+    std::vector<ubyte> serializeRegion(const region* reg) const;
+    /* Compress and write region file, called without the lock */
+    void writeRegion(int x, int z, const std::vector<ubyte>& data) const;
+    /* Save the region if unsaved, the lock is released while file is
+       written. Region must be marked busy */
+    void saveRegion(std::unique_lock<std::mutex>& lock, glm::ivec2 key, region* reg);
+    /* Unload least recently used regions, the lock may be released */
+    void evict(std::unique_lock<std::mutex>& lock);
+    fs::path getRegionFile(int x, int z) const;
+public:
+    /* @param folder cache files folder, created on first write
+       @param cache regions vertices refer to by index
+       @param vertexSize mesh vertex components */
+    MeshCache(fs::path folder,
+              const Content* content,
+              const ContentGfxCache* cache,
+              const EngineSettings& settings,
+              uint vertexSize);
+    /* Writes unsaved regions */
+    ~MeshCache();
+
+    /* @param x,z chunk position
+       @param section chunk mesh section index
+       @param hash section input hash (see hashSection)
+       @param data destination mesh data
+       @return false if there is no entry with the same hash */
+    bool get(int x, int z, int section, uint64_t hash, MeshData& data);
+    void put(int x, int z, int section, uint64_t hash, const MeshData& data);
+
+    /* Write unsaved regions to files */
+    void write();
+
+    /* Hash of voxels and lights which BlocksRenderer reads to mesh layers
+       bottom..top-1: the same layers with one layer around, including
+       volume padding taken from neighbour chunks */
+    static uint64_t hashSection(const VoxelsVolume* volume, int bottom, int top);
+};
+
+#endif // GRAPHICS_MESHCACHE_H_
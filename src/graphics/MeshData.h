@@ -0,0 +1,32 @@
+#ifndef GRAPHICS_MESHDATA_H_
+#define GRAPHICS_MESHDATA_H_
+
+#include <vector>
+#include "../typedefs.h"
+
+/* Mesh vertices and indices built on CPU side. Does not use GL,
+   so may be built in any thread and uploaded to a Mesh later.
+   Buffers are reused, only their first verticesCount vertices and
+   indicesCount indices are the mesh */
+struct MeshData {
+	/* vertices components, 4 bytes each */
+	std::vector<uint32_t> vertices;
+	std::vector<int> indices;
+	size_t verticesCount = 0;
+	size_t indicesCount = 0;
+	/* components per vertex */
+	uint vertexSize;
+
+	MeshData(uint vertexSize) : vertexSize(vertexSize) {}
+
+	size_t getVerticesCount() const {
+		return verticesCount;
+	}
+
+	void clear() {
+		verticesCount = 0;
+		indicesCount = 0;
+	}
+};
+
+#endif // GRAPHICS_MESHDATA_H_
@@ -0,0 +1,205 @@
+#include "VisibilityGraph.h"
+
+#include <algorithm>
+#include "ChunksRenderer.h"
+#include "../content/Content.h"
+#include "../voxels/Block.h"
+#include "../voxels/VoxelsVolume.h"
+#include "../constants.h"
+
+const int SECTION_VOLUME = CHUNK_W * CHUNK_D * MESH_SECTION_H;
+const ubyte NOT_VISITED = 0xFF;
+/* Entry of the camera section */
+const int START_FACE = SECTION_FACES;
+
+SectionConnectivity::SectionConnectivity(const Content* content)
+    : visited(new ubyte[SECTION_VOLUME]),
+      queue(new uint16_t[SECTION_VOLUME]) {
+    const ContentIndices* indices = content->getIndices();
+    opaque.resize(indices->countBlockDefs());
+    for (size_t id = 0; id < opaque.size(); id++) {
+        const Block* def = indices->getBlockDefs()[id];
+        opaque[id] = def->rt.solid && !def->lightPassing;
+    }
+}
+
+faces_connectivity SectionConnectivity::build(const VoxelsVolume* volume,
+                                              int y1, int y2,
+                                              int bottom, int top) {
+    const int layer = CHUNK_W * CHUNK_D;
+    const int height = y2 - y1;
+    const int w = volume->getW();
+    const int d = volume->getD();
+    const voxel* voxels = volume->getVoxels();
+
+    int open = 0;
+    for (int y = y1; y < y2; y++) {
+        ubyte* dst = visited.get() + (y - y1) * layer;
+        if (y < bottom || y >= top) {
+            std::fill(dst, dst + layer, 0);
+            open += layer;
+            continue;
+        }
+        for (int z = 0; z < CHUNK_D; z++) {
+            const voxel* src = voxels + vox_index(1, y, z + 1, w, d);
+            for (int x = 0; x < CHUNK_W; x++, dst++) {
+                *dst = opaque[src[x].id];
+                open += !*dst;
+            }
+        }
+    }
+    if (open == 0) {
+        return CONNECTED_NONE;
+    }
+    if (open == height * layer) {
+        return CONNECTED_ALL;
+    }
+
+    faces_connectivity connectivity = CONNECTED_NONE;
+    const int volumeSize = height * layer;
+    for (int start = 0; start < volumeSize; start++) {
+        if (visited[start]) {
+            continue;
+        }
+        // faces touched by the connected open voxels
+        uint faces = 0;
+        int head = 0;
+        int tail = 0;
+        auto visit = [this, &tail](int index) {
+            if (!visited[index]) {
+                visited[index] = 1;
+                queue[tail++] = index;
+            }
+        };
+        visit(start);
+        while (head < tail) {
+            int index = queue[head++];
+            int x = index % CHUNK_W;
+            int z = index / CHUNK_W % CHUNK_D;
+            int y = index / layer;
+            if (x < CHUNK_W - 1) {
+                visit(index + 1);
+            } else {
+                faces |= 1 << 0;
+            }
+            if (x > 0) {
+                visit(index - 1);
+            } else {
+                faces |= 1 << 1;
+            }
+            if (y < height - 1) {
+                visit(index + layer);
+            } else {
+                faces |= 1 << 2;
+            }
+            if (y > 0) {
+                visit(index - layer);
+            } else {
+                faces |= 1 << 3;
+            }
+            if (z < CHUNK_D - 1) {
+                visit(index + CHUNK_W);
+            } else {
+                faces |= 1 << 4;
+            }
+            if (z > 0) {
+                visit(index - CHUNK_W);
+            } else {
+                faces |= 1 << 5;
+            }
+        }
+        for (int a = 0; a < SECTION_FACES; a++) {
+            if (faces & (1 << a)) {
+                connectivity |= (faces_connectivity)faces << (a * SECTION_FACES);
+            }
+        }
+    }
+    return connectivity;
+}
+
+void VisibilityGraph::reset(int w, int h, int d, int ox, int oz) {
+    this->w = w;
+    this->h = h;
+    this->d = d;
+    this->ox = ox;
+    this->oz = oz;
+    size_t sections = (size_t)w * h * d;
+    connectivity.assign(sections, CONNECTED_ALL);
+    visible.assign(sections, 0);
+}
+
+void VisibilityGraph::set(int x, int y, int z, faces_connectivity connectivity) {
+    if (isInside(x, y, z)) {
+        this->connectivity[index(x, y, z)] = connectivity;
+    }
+}
+
+bool VisibilityGraph::collect(int x, int y, int z,
+                              const std::function<bool(int x, int y, int z)>& isInView) {
+    const size_t sections = connectivity.size();
+    std::fill(visible.begin(), visible.end(), 0);
+    if (!isInside(x, y, z)) {
+        return false;
+    }
+    directions.assign(sections * (SECTION_FACES + 1), NOT_VISITED);
+    inView.assign(sections, NOT_VISITED);
+    queue.clear();
+
+    const int offsets[SECTION_FACES][3] {
+        {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
+    };
+
+    uint startState = index(x, y, z) * (SECTION_FACES + 1) + START_FACE;
+    directions[startState] = 0;
+    queue.push_back(startState);
+    for (size_t head = 0; head < queue.size(); head++) {
+        uint state = queue[head];
+        int section = state / (SECTION_FACES + 1);
+        int entry = state % (SECTION_FACES + 1);
+        ubyte moved = directions[state];
+        visible[section] = 1;
+
+        int sy = section % h;
+        int sx = section / h % w + ox;
+        int sz = section / h / w + oz;
+        for (int face = 0; face < SECTION_FACES; face++) {
+            // never move back towards the camera
+            if (moved & (1 << (face ^ 1))) {
+                continue;
+            }
+            if (entry != START_FACE && !is_connected(connectivity[section], entry, face)) {
+                continue;
+            }
+            int nx = sx + offsets[face][0];
+            int ny = sy + offsets[face][1];
+            int nz = sz + offsets[face][2];
+            if (!isInside(nx, ny, nz)) {
+                continue;
+            }
+            int neighbour = index(nx, ny, nz);
+            if (inView[neighbour] == NOT_VISITED) {
+                inView[neighbour] = isInView(nx, ny, nz);
+            }
+            if (!inView[neighbour]) {
+                continue;
+            }
+            uint next = neighbour * (SECTION_FACES + 1) + (face ^ 1);
+            ubyte nextMoved = moved | (1 << face);
+            ubyte current = directions[next];
+            if (current != NOT_VISITED) {
+                // search again only with fewer restrictions
+                if ((current & nextMoved) == current) {
+                    continue;
+                }
+                nextMoved &= current;
+            }
+            directions[next] = nextMoved;
+            queue.push_back(next);
+        }
+    }
+    return true;
+}
+
+size_t VisibilityGraph::countVisible() const {
+    return std::count(visible.begin(), visible.end(), 1);
+}
@@ -0,0 +1,96 @@
+#ifndef GRAPHICS_VISIBILITYGRAPH_H_
+#define GRAPHICS_VISIBILITYGRAPH_H_
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include "../typedefs.h"
+
+class Content;
+class VoxelsVolume;
+
+/* Chunk section box faces: +X, -X, +Y, -Y, +Z, -Z (BlocksRenderer
+   DIRECTIONS order), opposite face is (face ^ 1) */
+const int SECTION_FACES = 6;
+
+/* Pairs of section faces connected through not opaque voxels:
+   bit (a * SECTION_FACES + b) is set if faces a and b are connected */
+typedef uint64_t faces_connectivity;
+const faces_connectivity CONNECTED_NONE = 0;
+const faces_connectivity CONNECTED_ALL = (1ULL << (SECTION_FACES * SECTION_FACES)) - 1;
+
+inline bool is_connected(faces_connectivity connectivity, int a, int b) {
+    return (connectivity >> (a * SECTION_FACES + b)) & 1;
+}
+
+/* Finds faces connectivity of chunk sections by flood fill of not
+   opaque voxels. Opaque are full blocks not passing light.
+   Holds buffers, so one is used per thread */
+class SectionConnectivity {
+    std::vector<ubyte> opaque;
+    std::unique_ptr<ubyte[]> visited;
+    std::unique_ptr<uint16_t[]> queue;
+public:
+    SectionConnectivity(const Content* content);
+
+    /* @param volume chunk voxels with one voxel padding on X and Z
+       (filled with ChunksStorage::getVoxels)
+       @param y1,y2 section layers range (up to MESH_SECTION_H layers)
+       @param bottom,top range of chunk layers containing blocks,
+       other layers are air and are not read from the volume */
+    faces_connectivity build(const VoxelsVolume* volume,
+                             int y1, int y2,
+                             int bottom, int top);
+};
+
+/* Chunks sections visible from the camera section, found by breadth-first
+   search through pairs of connected section faces (cave culling).
+   Search moves only away from the camera: never in direction opposite
+   to one already taken on the way to the section. Section reached by
+   several ways keeps the fewest restrictions of them, so any straight
+   line of sight through not opaque voxels is never culled */
+class VisibilityGraph {
+    int w = 0;
+    int h = 0;
+    int d = 0;
+    int ox = 0;
+    int oz = 0;
+    std::vector<faces_connectivity> connectivity;
+    /* Directions moved on the way to section entered through the face
+       (SECTION_FACES for the camera section) */
+    std::vector<ubyte> directions;
+    /* Frustum test results cache */
+    std::vector<ubyte> inView;
+    std::vector<ubyte> visible;
+    std::vector<uint> queue;
+
+    inline int index(int x, int y, int z) const {
+        return ((z - oz) * w + (x - ox)) * h + y;
+    }
+public:
+    /* Set grid of w*h*d sections (all faces connected) starting at
+       sections x=ox, y=0, z=oz */
+    void reset(int w, int h, int d, int ox, int oz);
+
+    void set(int x, int y, int z, faces_connectivity connectivity);
+
+    inline bool isInside(int x, int y, int z) const {
+        return x >= ox && y >= 0 && z >= oz && x < ox + w && y < h && z < oz + d;
+    }
+
+    /* Find sections visible from the camera section
+       @param x,y,z camera section
+       @param isInView section frustum test
+       @return false if the camera section is out of grid */
+    bool collect(int x, int y, int z,
+                 const std::function<bool(int x, int y, int z)>& isInView);
+
+    /* @return true if the section was reached by the last collect */
+    inline bool isVisible(int x, int y, int z) const {
+        return isInside(x, y, z) && visible[index(x, y, z)];
+    }
+
+    size_t countVisible() const;
+};
+
+#endif // GRAPHICS_VISIBILITYGRAPH_H_
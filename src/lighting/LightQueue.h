@@ -0,0 +1,126 @@
+#ifndef LIGHTING_LIGHTQUEUE_H_
+#define LIGHTING_LIGHTQUEUE_H_
+
+#include <memory>
+#include "../typedefs.h"
+#include "../constants.h"
+#include "../voxels/Chunk.h"
+#include "../voxels/Chunks.h"
+
+/* Packed light propagation entry */
+struct lightentry {
+	Chunk* chunk;
+	/* chunk-local voxel index (see vox_index) */
+	uint16_t index;
+	light_t light;
+};
+
+/* FIFO ring buffer of light entries, preallocated and growing
+   only if there is no more free space */
+class LightQueue {
+	std::unique_ptr<lightentry[]> buffer;
+	size_t capacity;
+	size_t head = 0;
+	size_t count = 0;
+
+	void grow() {
+		std::unique_ptr<lightentry[]> newbuffer (new lightentry[capacity * 2]);
+		for (size_t i = 0; i < count; i++) {
+			newbuffer[i] = buffer[(head + i) & (capacity - 1)];
+		}
+		buffer = std::move(newbuffer);
+		capacity *= 2;
+		head = 0;
+	}
+public:
+	/* @param capacity initial capacity, must be a power of two */
+	LightQueue(size_t capacity=1 << 16)
+	: buffer(new lightentry[capacity]), capacity(capacity) {
+	}
+
+	inline void push(Chunk* chunk, uint index, light_t light) {
+		if (count == capacity) {
+			grow();
+		}
+		lightentry& entry = buffer[(head + count) & (capacity - 1)];
+		entry.chunk = chunk;
+		entry.index = index;
+		entry.light = light;
+		count++;
+	}
+
+	inline lightentry pop() {
+		lightentry entry = buffer[head];
+		head = (head + 1) & (capacity - 1);
+		count--;
+		return entry;
+	}
+
+	inline bool empty() const {
+		return count == 0;
+	}
+
+	inline size_t size() const {
+		return count;
+	}
+};
+
+/* Mark voxel which light was changed (see Chunks::markModified) */
+inline void light_changed(Chunks* chunks, Chunk* chunk, uint index) {
+	chunks->markModified(chunk,
+		index % CHUNK_W,
+		index / (CHUNK_W * CHUNK_D),
+		index / CHUNK_W % CHUNK_D);
+}
+
+/* Step from voxel to its neighbour at the side, staying in the same
+   chunk when possible. Sides order is +Z, -Z, +Y, -Y, +X, -X
+   @param index chunk-local voxel index, replaced with neighbour index
+   @return neighbour voxel chunk or nullptr if not available */
+inline Chunk* light_neighbour(Chunks* chunks, Chunk* chunk, uint& index, int side) {
+	const uint layer = CHUNK_W * CHUNK_D;
+	switch (side) {
+		case 0:
+			if ((index / CHUNK_W) % CHUNK_D < CHUNK_D-1) {
+				index += CHUNK_W;
+				return chunk;
+			}
+			index -= (CHUNK_D-1) * CHUNK_W;
+			return chunks->getChunk(chunk->x, chunk->z+1);
+		case 1:
+			if ((index / CHUNK_W) % CHUNK_D > 0) {
+				index -= CHUNK_W;
+				return chunk;
+			}
+			index += (CHUNK_D-1) * CHUNK_W;
+			return chunks->getChunk(chunk->x, chunk->z-1);
+		case 2:
+			if (index / layer < CHUNK_H-1) {
+				index += layer;
+				return chunk;
+			}
+			return nullptr;
+		case 3:
+			if (index >= layer) {
+				index -= layer;
+				return chunk;
+			}
+			return nullptr;
+		case 4:
+			if (index % CHUNK_W < CHUNK_W-1) {
+				index++;
+				return chunk;
+			}
+			index -= CHUNK_W-1;
+			return chunks->getChunk(chunk->x+1, chunk->z);
+		default:
+			if (index % CHUNK_W > 0) {
+				index--;
+				return chunk;
+			}
+			index += CHUNK_W-1;
+			return chunks->getChunk(chunk->x-1, chunk->z);
+	}
+}
+
+#endif /* LIGHTING_LIGHTQUEUE_H_ */
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include <assert.h>
 #include "LightSolver.h"
 #include "Lightmap.h"
@@ -8,23 +9,28 @@
 #include "../voxels/voxel.h"
 #include "../voxels/Block.h"
 
-LightSolver::LightSolver(const ContentIndices* contentIds, Chunks* chunks, int channel) 
+LightSolver::LightSolver(const ContentIndices* contentIds, Chunks* chunks, int channel)
 	: contentIds(contentIds), chunks(chunks), channel(channel) {
 }
 
 void LightSolver::add(int x, int y, int z, int emission) {
 	if (emission <= 1)
 		return;
-	lightentry entry;
-	entry.x = x;
-	entry.y = y;
-	entry.z = z;
-	entry.light = emission;
-	addqueue.push(entry);
-
-	Chunk* chunk = chunks->getChunkByVoxel(entry.x, entry.y, entry.z);
-	chunk->setModified(true);
-	chunk->lightmap->set(entry.x-chunk->x*CHUNK_W, entry.y, entry.z-chunk->z*CHUNK_D, channel, entry.light);
+	Chunk* chunk = chunks->getChunkByVoxel(x, y, z);
+	if (chunk == nullptr)
+		return;
+	uint index = vox_index(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D);
+	light_t* map = chunk->lightmap->map;
+	const int shift = channel << 2;
+	// emission does not lower light coming from other sources
+	const int current = (map[index] >> shift) & 0xF;
+	if (emission > current) {
+		map[index] = (map[index] & ~(0xF << shift)) | (emission << shift);
+		light_changed(chunks, chunk, index);
+	} else {
+		emission = current;
+	}
+	addqueue.push(chunk, index, emission);
 }
 
 void LightSolver::add(int x, int y, int z) {
@@ -37,91 +43,66 @@ void LightSolver::remove(int x, int y, int z) {
 	if (chunk == nullptr)
 		return;
 
-	int light = chunk->lightmap->get(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel);
+	uint index = vox_index(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D);
+	light_t* map = chunk->lightmap->map;
+	const int shift = channel << 2;
+	int light = (map[index] >> shift) & 0xF;
 	if (light == 0){
 		return;
 	}
-
-	lightentry entry;
-	entry.x = x;
-	entry.y = y;
-	entry.z = z;
-	entry.light = light;
-	remqueue.push(entry);
-
-	chunk->lightmap->set(entry.x-chunk->x*CHUNK_W, entry.y, entry.z-chunk->z*CHUNK_D, channel, 0);
+	remqueue.push(chunk, index, light);
+	map[index] &= ~(0xF << shift);
+	light_changed(chunks, chunk, index);
 }
 
 void LightSolver::solve(){
-	const int coords[] = {
-			0, 0, 1,
-			0, 0,-1,
-			0, 1, 0,
-			0,-1, 0,
-			1, 0, 0,
-		   -1, 0, 0
-	};
+	const int shift = channel << 2;
+	const light_t mask = ~(0xF << shift);
 
 	while (!remqueue.empty()){
-		const lightentry entry = remqueue.front();
-		remqueue.pop();
+		const lightentry entry = remqueue.pop();
 
-		for (size_t i = 0; i < 6; i++) {
-			int x = entry.x+coords[i*3+0];
-			int y = entry.y+coords[i*3+1];
-			int z = entry.z+coords[i*3+2];
-			Chunk* chunk = chunks->getChunkByVoxel(x,y,z);
-			if (chunk) {
-				chunk->setModified(true);
-				int light = chunks->getLight(x,y,z, channel);
-				if (light != 0 && light == entry.light-1){
-					lightentry nentry;
-					nentry.x = x;
-					nentry.y = y;
-					nentry.z = z;
-					nentry.light = light;
-					remqueue.push(nentry);
-					chunk->lightmap->set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, 0);
-				}
-				else if (light >= entry.light){
-					lightentry nentry;
-					nentry.x = x;
-					nentry.y = y;
-					nentry.z = z;
-					nentry.light = light;
-					addqueue.push(nentry);
-				}
+		for (int side = 0; side < 6; side++) {
+			uint index = entry.index;
+			Chunk* chunk = light_neighbour(chunks, entry.chunk, index, side);
+			if (chunk == nullptr)
+				continue;
+			light_t* map = chunk->lightmap->map;
+			int light = (map[index] >> shift) & 0xF;
+			if (light != 0 && light == entry.light-1){
+				remqueue.push(chunk, index, light);
+				map[index] &= mask;
+				light_changed(chunks, chunk, index);
+			}
+			else if (light >= entry.light){
+				addqueue.push(chunk, index, light);
 			}
 		}
 	}
 
 	const Block* const* blockDefs = contentIds->getBlockDefs();
 	while (!addqueue.empty()){
-		const lightentry entry = addqueue.front();
-		addqueue.pop();
+		const lightentry entry = addqueue.pop();
 
 		if (entry.light <= 1)
 			continue;
+		// light changed after the entry was pushed: removed light must not
+		// spread, increased light has its own entry propagating further
+		if (((entry.chunk->lightmap->map[entry.index] >> shift) & 0xF) != entry.light)
+			continue;
 
-		for (size_t i = 0; i < 6; i++) {
-			int x = entry.x+coords[i*3+0];
-			int y = entry.y+coords[i*3+1];
-			int z = entry.z+coords[i*3+2];
-			Chunk* chunk = chunks->getChunkByVoxel(x,y,z);
-			if (chunk) {
-				chunk->setModified(true);
-				int light = chunks->getLight(x,y,z, channel);
-				voxel* v = chunks->get(x,y,z);
-				const Block* block = blockDefs[v->id];
-				if (block->lightPassing && light+2 <= entry.light){
-					chunk->lightmap->set(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D, channel, entry.light-1);
-					lightentry nentry;
-					nentry.x = x;
-					nentry.y = y;
-					nentry.z = z;
-					nentry.light = entry.light-1;
-					addqueue.push(nentry);
-				}
+		for (int side = 0; side < 6; side++) {
+			uint index = entry.index;
+			Chunk* chunk = light_neighbour(chunks, entry.chunk, index, side);
+			if (chunk == nullptr)
+				continue;
+			light_t* map = chunk->lightmap->map;
+			int light = (map[index] >> shift) & 0xF;
+			// light is checked first as it is cheaper than block lookup
+			if (light+2 <= entry.light && blockDefs[chunk->voxels[index].id]->lightPassing){
+				map[index] = (map[index] & mask) | ((entry.light-1) << shift);
+				addqueue.push(chunk, index, entry.light-1);
+				light_changed(chunks, chunk, index);
 			}
 		}
 	}
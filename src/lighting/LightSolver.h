@@ -1,21 +1,15 @@
 #ifndef LIGHTING_LIGHTSOLVER_H_
 #define LIGHTING_LIGHTSOLVER_H_
 
-#include <queue>
+#include "LightQueue.h"
 
+class Chunk;
 class Chunks;
 class ContentIndices;
 
-struct lightentry {
-	int x;
-	int y;
-	int z;
-	unsigned char light;
-};
-
 class LightSolver {
-	std::queue<lightentry> addqueue;
-	std::queue<lightentry> remqueue;
+	LightQueue addqueue;
+	LightQueue remqueue;
 	const ContentIndices* const contentIds;
 	Chunks* chunks;
 	int channel;
@@ -1,5 +1,6 @@
 #include "Lighting.h"
 #include "LightSolver.h"
+#include "RGBLightSolver.h"
 #include "Lightmap.h"
 #include "../content/Content.h"
 #include "../voxels/Chunks.h"
@@ -11,23 +12,91 @@
 
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+struct Lighting::chunk_lighting {
+	// 1x1 matrix view makes neighbour chunks unreachable
+	Chunks view;
+	Lighting lighting;
+
+	chunk_lighting(const Content* content)
+		: view(1, 1, 0, 0, nullptr, nullptr, content),
+		  lighting(content, &view) {
+	}
+};
 
 Lighting::Lighting(const Content* content, Chunks* chunks) 
 	     : content(content), chunks(chunks) {
 	auto indices = content->getIndices();
-	solverR = new LightSolver(indices, chunks, 0);
-	solverG = new LightSolver(indices, chunks, 1);
-	solverB = new LightSolver(indices, chunks, 2);
+	solverRGB = new RGBLightSolver(indices, chunks);
 	solverS = new LightSolver(indices, chunks, 3);
 }
 
 Lighting::~Lighting(){
-	delete solverR;
-	delete solverG;
-	delete solverB;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	taskCondition.notify_all();
+	for (auto& thread : workers){
+		thread.join();
+	}
+	delete solverRGB;
 	delete solverS;
 }
 
+void Lighting::startWorkers(uint count){
+	// the calling thread one
+	if (isolated.empty()){
+		isolated.push_back(std::make_unique<chunk_lighting>(content));
+	}
+	while (workers.size() < count){
+		auto worker = std::make_unique<chunk_lighting>(content);
+		workers.emplace_back(&Lighting::work, this, worker.get());
+		isolated.insert(isolated.begin(), std::move(worker));
+	}
+}
+
+void Lighting::work(chunk_lighting* worker){
+	uint64_t lastTaskId = 0;
+	while (true){
+		const std::vector<std::shared_ptr<Chunk>>* batch;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskCondition.wait(lock, [this, lastTaskId]() {
+				return stopped || (taskId != lastTaskId && taskSlots > 0);
+			});
+			if (stopped)
+				return;
+			lastTaskId = taskId;
+			taskSlots--;
+			batch = task;
+		}
+		lightIsolated(worker, *batch);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			taskRunning--;
+		}
+		doneCondition.notify_all();
+	}
+}
+
+void Lighting::lightIsolated(chunk_lighting* worker,
+							 const std::vector<std::shared_ptr<Chunk>>& batch){
+	Chunks& view = worker->view;
+	size_t index;
+	while ((index = nextIndex++) < batch.size()){
+		auto& chunk = batch[index];
+		view._setOffset(chunk->x, chunk->z);
+		view.chunks[0] = chunk;
+		worker->lighting.buildSkyLight(chunk->x, chunk->z);
+		worker->lighting.onChunkLoaded(chunk->x, chunk->z);
+	}
+	view.chunks[0] = nullptr;
+}
+
 void Lighting::clear(){
 	for (unsigned int index = 0; index < chunks->volume; index++){
 		auto chunk = chunks->chunks[index];
@@ -44,48 +113,107 @@ void Lighting::prebuildSkyLight(int cx, int cz){
 	const Block* const* blockDefs = content->getIndices()->getBlockDefs();
 
 	Chunk* chunk = chunks->getChunk(cx, cz);
+	Lightmap* lightmap = chunk->lightmap;
 	int highestPoint = 0;
+	// layers above all columns heights are sky lighted entirely
+	int fullLayers = 0;
 	for (int z = 0; z < CHUNK_D; z++){
 		for (int x = 0; x < CHUNK_W; x++){
-			for (int y = CHUNK_H-1;;y--){
-				if (y < 0)
-					break;
-				voxel* vox = &(chunk->voxels[(y * CHUNK_D + z) * CHUNK_W + x]);
-				const Block* block = blockDefs[vox->id];
-				if (!block->skyLightPassing) {
-					if (highestPoint < y)
-						highestPoint = y;
-					break;
-				}
-				chunk->lightmap->setS(x,y,z, 15);
+			int y = CHUNK_H-1;
+			while (y >= 0 && blockDefs[chunk->voxels[vox_index(x, y, z)].id]->skyLightPassing){
+				y--;
+			}
+			lightmap->skyHeights[z * CHUNK_W + x] = y;
+			if (highestPoint < y)
+				highestPoint = y;
+			if (fullLayers < y + 1)
+				fullLayers = y + 1;
+		}
+	}
+	light_t* map = lightmap->map;
+	for (uint i = fullLayers * CHUNK_W * CHUNK_D; i < CHUNK_VOL; i++){
+		map[i] |= 0xF000;
+	}
+	for (int z = 0; z < CHUNK_D; z++){
+		for (int x = 0; x < CHUNK_W; x++){
+			for (int y = lightmap->skyHeights[z * CHUNK_W + x] + 1; y < fullLayers; y++){
+				map[vox_index(x, y, z)] |= 0xF000;
 			}
 		}
 	}
 	if (highestPoint < CHUNK_H-1)
 		highestPoint++;
-	chunk->lightmap->highestPoint = highestPoint;
+	lightmap->highestPoint = highestPoint;
+}
+
+/* Sky lighted span of one column is exposed to shadowed part
+   of the other one, if it is lower */
+void Lighting::seedSkyColumns(const Chunk* chunk, int ax, int az, int bx, int bz){
+	const Block* const* blockDefs = content->getIndices()->getBlockDefs();
+	const short* heights = chunk->lightmap->skyHeights;
+	int ha = heights[az * CHUNK_W + ax];
+	int hb = heights[bz * CHUNK_W + bx];
+	if (ha > hb){
+		std::swap(ha, hb);
+		std::swap(ax, bx);
+		std::swap(az, bz);
+	}
+	const int gx = chunk->x * CHUNK_W;
+	const int gz = chunk->z * CHUNK_D;
+	for (int y = ha + 1; y <= hb; y++){
+		if (blockDefs[chunk->voxels[vox_index(bx, y, bz)].id]->lightPassing){
+			solverS->add(gx + ax, y, gz + az);
+		}
+	}
 }
 
 void Lighting::buildSkyLight(int cx, int cz){
 	const Block* const* blockDefs = content->getIndices()->getBlockDefs();
 
 	Chunk* chunk = chunks->getChunk(cx, cz);
+	const short* heights = chunk->lightmap->skyHeights;
+	const int gx = cx * CHUNK_W;
+	const int gz = cz * CHUNK_D;
 	for (int z = 0; z < CHUNK_D; z++){
 		for (int x = 0; x < CHUNK_W; x++){
-			for (int y = chunk->lightmap->highestPoint; y >= 0; y--){
-				int gx = x + cx * CHUNK_W;
-				int gz = z + cz * CHUNK_D;
-				while (y > 0 && !blockDefs[chunk->voxels[vox_index(x, y, z)].id]->lightPassing) {
-					y--;
-				}
-				if (chunk->lightmap->getS(x, y, z) != 15) {
-					solverS->add(gx,y+1,gz);
-					for (; y >= 0; y--){
-						solverS->add(gx+1,y,gz);
-						solverS->add(gx-1,y,gz);
-						solverS->add(gx,y,gz+1);
-						solverS->add(gx,y,gz-1);
-					}
+			// sky light passing down through light passing blocker
+			int height = heights[z * CHUNK_W + x];
+			if (height >= 0 && height < CHUNK_H-1 &&
+				blockDefs[chunk->voxels[vox_index(x, height, z)].id]->lightPassing){
+				solverS->add(gx + x, height + 1, gz + z);
+			}
+			if (x+1 < CHUNK_W)
+				seedSkyColumns(chunk, x, z, x+1, z);
+			if (z+1 < CHUNK_D)
+				seedSkyColumns(chunk, x, z, x, z+1);
+		}
+	}
+
+	// neighbour chunks heights may be unknown (lights loaded),
+	// so border voxels are compared by light
+	const light_t* map = chunk->lightmap->map;
+	for (int side = 0; side < 4; side++){
+		const int nx = cx + (side == 0) - (side == 1);
+		const int nz = cz + (side == 2) - (side == 3);
+		const Chunk* neighbour = chunks->getChunk(nx, nz);
+		if (neighbour == nullptr)
+			continue;
+		const light_t* nmap = neighbour->lightmap->map;
+		for (int i = 0; i < (side < 2 ? CHUNK_D : CHUNK_W); i++){
+			int x, z, ox, oz;
+			switch (side){
+				case 0: x = CHUNK_W-1; z = i; ox = 0; oz = i; break;
+				case 1: x = 0; z = i; ox = CHUNK_W-1; oz = i; break;
+				case 2: x = i; z = CHUNK_D-1; ox = i; oz = 0; break;
+				default: x = i; z = 0; ox = i; oz = CHUNK_D-1; break;
+			}
+			for (int y = 0; y < CHUNK_H; y++){
+				int light = Lightmap::extract(map[vox_index(x, y, z)], 3);
+				int nlight = Lightmap::extract(nmap[vox_index(ox, y, oz)], 3);
+				if (light > nlight + 1){
+					solverS->add(gx + x, y, gz + z);
+				} else if (nlight > light + 1){
+					solverS->add(nx * CHUNK_W + ox, y, nz * CHUNK_D + oz);
 				}
 			}
 		}
@@ -105,9 +233,10 @@ void Lighting::onChunkLoaded(int cx, int cz){
 				int gx = x + cx * CHUNK_W;
 				int gz = z + cz * CHUNK_D;
 				if (block->emission[0] || block->emission[1] || block->emission[2]){
-					solverR->add(gx,y,gz,block->emission[0]);
-					solverG->add(gx,y,gz,block->emission[1]);
-					solverB->add(gx,y,gz,block->emission[2]);
+					solverRGB->add(gx,y,gz,
+						block->emission[0],
+						block->emission[1],
+						block->emission[2]);
 				}
 			}
 		}
@@ -120,53 +249,129 @@ void Lighting::onChunkLoaded(int cx, int cz){
 					continue;
 				int gx = x + cx * CHUNK_W;
 				int gz = z + cz * CHUNK_D;
-				if (chunks->getLight(x,y,z)){
-					solverR->add(gx,y,gz);
-					solverG->add(gx,y,gz);
-					solverB->add(gx,y,gz);
+				if (chunks->getLight(gx,y,gz)){
+					solverRGB->add(gx,y,gz);
 					solverS->add(gx,y,gz);
 				}
 			}
 		}
 	}
-	solverR->solve();
-	solverG->solve();
-	solverB->solve();
+	solverRGB->solve();
 	solverS->solve();
 }
 
-void Lighting::onBlockSet(int x, int y, int z, int const id){
-	Block* block = content->getIndices()->getBlockDef(id);
-	if (id == 0){
-		solverR->remove(x,y,z);
-		solverG->remove(x,y,z);
-		solverB->remove(x,y,z);
-		solverR->solve();
-		solverG->solve();
-		solverB->solve();
-		if (chunks->getLight(x,y+1,z, 3) == 0xF){
-			for (int i = y; i >= 0; i--){
-				voxel* vox = chunks->get(x,i,z);
-				if ((vox == nullptr || vox->id != 0) && block->skyLightPassing)
-					break;
-				solverS->add(x,i,z, 0xF);
+void Lighting::buildChunks(const std::vector<std::shared_ptr<Chunk>>& batch, uint threads){
+	if (threads <= 1 || batch.size() <= 1){
+		for (auto& chunk : batch){
+			buildSkyLight(chunk->x, chunk->z);
+			onChunkLoaded(chunk->x, chunk->z);
+		}
+		return;
+	}
+
+	uint helpers = std::min(threads, (uint)batch.size()) - 1;
+	startWorkers(helpers);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = &batch;
+		taskId++;
+		taskSlots = helpers;
+		taskRunning = helpers;
+		nextIndex = 0;
+	}
+	taskCondition.notify_all();
+	lightIsolated(isolated.back().get(), batch);
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		// workers not woken yet have nothing left to do
+		taskRunning -= taskSlots;
+		taskSlots = 0;
+		doneCondition.wait(lock, [this]() {
+			return taskRunning == 0;
+		});
+		task = nullptr;
+	}
+
+	// workers could not mark neighbour chunks meshes depending on
+	// changed border voxels, so changed layers are marked here
+	for (auto& chunk : batch){
+		if (!chunk->isModified())
+			continue;
+		for (int dz = -1; dz <= 1; dz++){
+			for (int dx = -1; dx <= 1; dx++){
+				Chunk* other = chunks->getChunk(chunk->x+dx, chunk->z+dz);
+				if (other && other != chunk.get())
+					other->setModifiedLayers(chunk->modifiedBottom, chunk->modifiedTop);
 			}
 		}
-		solverR->add(x,y+1,z); solverG->add(x,y+1,z); solverB->add(x,y+1,z); solverS->add(x,y+1,z);
-		solverR->add(x,y-1,z); solverG->add(x,y-1,z); solverB->add(x,y-1,z); solverS->add(x,y-1,z);
-		solverR->add(x+1,y,z); solverG->add(x+1,y,z); solverB->add(x+1,y,z); solverS->add(x+1,y,z);
-		solverR->add(x-1,y,z); solverG->add(x-1,y,z); solverB->add(x-1,y,z); solverS->add(x-1,y,z);
-		solverR->add(x,y,z+1); solverG->add(x,y,z+1); solverB->add(x,y,z+1); solverS->add(x,y,z+1);
-		solverR->add(x,y,z-1); solverG->add(x,y,z-1); solverB->add(x,y,z-1); solverS->add(x,y,z-1);
-		solverR->solve();
-		solverG->solve();
-		solverB->solve();
-		solverS->solve();
-	} else {
-		solverR->remove(x,y,z);
-		solverG->remove(x,y,z);
-		solverB->remove(x,y,z);
-		if (!block->skyLightPassing){
+	}
+
+	// chunks are consistent inside, so light may spread only through
+	// borders where neighbour voxels differ more than by 1
+	auto reconcile = [this](int ax, int y, int az, int bx, int bz) {
+		light_t a = chunks->getLight(ax, y, az);
+		light_t b = chunks->getLight(bx, y, bz);
+		// different channels may spread in opposite directions
+		bool spreadsA = false;
+		bool spreadsB = false;
+		for (int channel = 0; channel < 3; channel++){
+			int la = Lightmap::extract(a, channel);
+			int lb = Lightmap::extract(b, channel);
+			spreadsA |= la > lb + 1;
+			spreadsB |= lb > la + 1;
+		}
+		if (spreadsA) solverRGB->add(ax, y, az);
+		if (spreadsB) solverRGB->add(bx, y, bz);
+
+		int la = Lightmap::extract(a, 3);
+		int lb = Lightmap::extract(b, 3);
+		if (la > lb + 1) {
+			solverS->add(ax, y, az);
+		} else if (lb > la + 1) {
+			solverS->add(bx, y, bz);
+		}
+	};
+	for (auto& chunk : batch){
+		const int gx = chunk->x * CHUNK_W;
+		const int gz = chunk->z * CHUNK_D;
+		for (int y = 0; y < CHUNK_H; y++){
+			for (int i = 0; i < CHUNK_D; i++){
+				reconcile(gx, y, gz+i, gx-1, gz+i);
+				reconcile(gx+CHUNK_W-1, y, gz+i, gx+CHUNK_W, gz+i);
+			}
+			for (int i = 0; i < CHUNK_W; i++){
+				reconcile(gx+i, y, gz, gx+i, gz-1);
+				reconcile(gx+i, y, gz+CHUNK_D-1, gx+i, gz+CHUNK_D);
+			}
+		}
+	}
+	solverRGB->solve();
+	solverS->solve();
+}
+
+void Lighting::onBlockSet(int x, int y, int z, int const id){
+	changes.push_back({x, y, z, (blockid_t)id});
+	if (transactions == 0)
+		solveChanges();
+}
+
+void Lighting::beginTransaction(){
+	transactions++;
+}
+
+void Lighting::endTransaction(){
+	if (--transactions == 0 && !changes.empty())
+		solveChanges();
+}
+
+void Lighting::solveChanges(){
+	auto indices = content->getIndices();
+	// all removals are solved before any light is added
+	for (const light_change& change : changes){
+		const int x = change.x, y = change.y, z = change.z;
+		Block* block = indices->getBlockDef(change.id);
+		solverRGB->remove(x,y,z);
+		if (change.id != 0 && !block->skyLightPassing){
 			solverS->remove(x,y,z);
 			for (int i = y-1; i >= 0; i--){
 				solverS->remove(x,i,z);
@@ -174,19 +379,37 @@ void Lighting::onBlockSet(int x, int y, int z, int const id){
 					break;
 				}
 			}
-			solverS->solve();
 		}
-		solverR->solve();
-		solverG->solve();
-		solverB->solve();
+	}
+	solverRGB->solve();
+	solverS->solve();
 
-		if (block->emission[0] || block->emission[1] || block->emission[2]){
-			solverR->add(x,y,z,block->emission[0]);
-			solverG->add(x,y,z,block->emission[1]);
-			solverB->add(x,y,z,block->emission[2]);
-			solverR->solve();
-			solverG->solve();
-			solverB->solve();
+	for (const light_change& change : changes){
+		const int x = change.x, y = change.y, z = change.z;
+		Block* block = indices->getBlockDef(change.id);
+		if (change.id == 0){
+			if (chunks->getLight(x,y+1,z, 3) == 0xF){
+				for (int i = y; i >= 0; i--){
+					voxel* vox = chunks->get(x,i,z);
+					if ((vox == nullptr || vox->id != 0) && block->skyLightPassing)
+						break;
+					solverS->add(x,i,z, 0xF);
+				}
+			}
+			solverRGB->add(x,y+1,z); solverS->add(x,y+1,z);
+			solverRGB->add(x,y-1,z); solverS->add(x,y-1,z);
+			solverRGB->add(x+1,y,z); solverS->add(x+1,y,z);
+			solverRGB->add(x-1,y,z); solverS->add(x-1,y,z);
+			solverRGB->add(x,y,z+1); solverS->add(x,y,z+1);
+			solverRGB->add(x,y,z-1); solverS->add(x,y,z-1);
+		} else if (block->emission[0] || block->emission[1] || block->emission[2]){
+			solverRGB->add(x,y,z,
+				block->emission[0],
+				block->emission[1],
+				block->emission[2]);
 		}
 	}
+	solverRGB->solve();
+	solverS->solve();
+	changes.clear();
 }
@@ -1,17 +1,65 @@
 #ifndef LIGHTING_LIGHTING_H_
 #define LIGHTING_LIGHTING_H_
 
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include "../typedefs.h"
+
 class Content;
+class Chunk;
 class Chunks;
 class LightSolver;
+class RGBLightSolver;
+
+/* Block change waiting for lighting update */
+struct light_change {
+	int x, y, z;
+	blockid_t id;
+};
 
 class Lighting {
+	/* Chunks view and lighting of one chunk isolated from others */
+	struct chunk_lighting;
+
 	const Content* const content;
 	Chunks* chunks;
-	LightSolver* solverR;
-	LightSolver* solverG;
-	LightSolver* solverB;
+	/* block light channels are propagated together */
+	RGBLightSolver* solverRGB;
 	LightSolver* solverS;
+	std::vector<light_change> changes;
+	/* Open transactions count */
+	int transactions = 0;
+
+	/* buildChunks workers, started on first use and kept until
+	   destruction. Last one is used by the calling thread */
+	std::vector<std::unique_ptr<chunk_lighting>> isolated;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable taskCondition;
+	std::condition_variable doneCondition;
+	/* Guarded by mutex */
+	const std::vector<std::shared_ptr<Chunk>>* task = nullptr;
+	uint64_t taskId = 0;
+	/* Workers yet to join the task */
+	uint taskSlots = 0;
+	/* Workers joined the task and not finished */
+	uint taskRunning = 0;
+	bool stopped = false;
+	std::atomic<size_t> nextIndex {0};
+
+	void startWorkers(uint count);
+	void work(chunk_lighting* worker);
+	/* Light task chunks taken by index until none left */
+	void lightIsolated(chunk_lighting* worker,
+					   const std::vector<std::shared_ptr<Chunk>>& batch);
+
+	/* Update lighting for collected block changes at once */
+	void solveChanges();
+	void seedSkyColumns(const Chunk* chunk, int ax, int az, int bx, int bz);
 public:
 	Lighting(const Content* content, Chunks* chunks);
 	~Lighting();
@@ -20,7 +68,21 @@ public:
 	void prebuildSkyLight(int cx, int cz);
 	void buildSkyLight(int cx, int cz);
 	void onChunkLoaded(int cx, int cz);
+	/* Same as buildSkyLight and onChunkLoaded called for every chunk
+	   of the batch. Chunks interior light is calculated by worker
+	   threads, each chunk isolated from others, then light crossing
+	   chunks borders is propagated on the calling thread.
+	   Chunks must be prebuilt (see prebuildSkyLight)
+	   @param threads threads count including the calling one,
+	   worker threads are reused by next calls */
+	void buildChunks(const std::vector<std::shared_ptr<Chunk>>& batch, uint threads);
 	void onBlockSet(int x, int y, int z, int id);
+
+	/* Lighting of blocks set in transaction is updated on its end
+	   by one removal and one propagation pass for all changes.
+	   Nested transactions are joined to the outermost one */
+	void beginTransaction();
+	void endTransaction();
 };
 
 #endif /* LIGHTING_LIGHTING_H_ */
@@ -12,6 +12,9 @@ class Lightmap {
 public:
 	light_t* map;
 	int highestPoint = 0;
+	/* Columns (z * CHUNK_W + x) highest sky light blocking voxel y
+	   or -1, voxels above are sky lighted (see Lighting::prebuildSkyLight) */
+	short skyHeights[CHUNK_W*CHUNK_D];
 	Lightmap();
 	~Lightmap();
 
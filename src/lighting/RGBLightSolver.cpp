@@ -0,0 +1,151 @@
+#include "RGBLightSolver.h"
+#include "Lightmap.h"
+#include "../content/Content.h"
+#include "../voxels/Chunks.h"
+#include "../voxels/Chunk.h"
+#include "../voxels/voxel.h"
+#include "../voxels/Block.h"
+
+/* RGB nibbles of light_t */
+const light_t RGB_MASK = 0x0FFF;
+
+/* Lanes operations. R, G, B values (0-15) are spread to bytes
+   of uint32 so per-channel comparisons do not overflow to
+   the next channel */
+namespace lanes {
+	const uint32_t HIGH = 0x808080;
+	const uint32_t ONES = 0x010101;
+
+	inline uint32_t spread(light_t light) {
+		return (light & 0xF) | ((light & 0xF0) << 4) | ((light & 0xF00) << 8);
+	}
+
+	inline light_t pack(uint32_t v) {
+		return (v & 0xF) | ((v >> 4) & 0xF0) | ((v >> 8) & 0xF00);
+	}
+
+	/* @return 0xFF in lanes where a >= b */
+	inline uint32_t ge(uint32_t a, uint32_t b) {
+		return ((((a | HIGH) - b) & HIGH) >> 7) * 0xFF;
+	}
+
+	/* Decrement non-zero lanes */
+	inline uint32_t dec(uint32_t v) {
+		return v - (ge(v, ONES) & ONES);
+	}
+}
+
+RGBLightSolver::RGBLightSolver(const ContentIndices* contentIds, Chunks* chunks)
+	: contentIds(contentIds), chunks(chunks) {
+}
+
+void RGBLightSolver::add(int x, int y, int z, int r, int g, int b) {
+	light_t mask = (r > 1 ? 0xF : 0) | (g > 1 ? 0xF0 : 0) | (b > 1 ? 0xF00 : 0);
+	if (mask == 0)
+		return;
+	Chunk* chunk = chunks->getChunkByVoxel(x, y, z);
+	if (chunk == nullptr)
+		return;
+	uint index = vox_index(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D);
+	light_t* map = chunk->lightmap->map;
+	// emission does not lower light coming from other sources
+	uint32_t emission = lanes::spread(Lightmap::combine(r, g, b, 0) & mask);
+	uint32_t current = lanes::spread(map[index] & mask);
+	uint32_t greater = lanes::ge(current, emission);
+	light_t light = lanes::pack((current & greater) | (emission & ~greater));
+	addqueue.push(chunk, index, light);
+
+	if ((map[index] & mask) != light) {
+		map[index] = (map[index] & ~mask) | light;
+		light_changed(chunks, chunk, index);
+	}
+}
+
+void RGBLightSolver::add(int x, int y, int z) {
+	light_t light = chunks->getLight(x, y, z);
+	add(x, y, z,
+		Lightmap::extract(light, 0),
+		Lightmap::extract(light, 1),
+		Lightmap::extract(light, 2));
+}
+
+void RGBLightSolver::remove(int x, int y, int z) {
+	Chunk* chunk = chunks->getChunkByVoxel(x, y, z);
+	if (chunk == nullptr)
+		return;
+
+	uint index = vox_index(x-chunk->x*CHUNK_W, y, z-chunk->z*CHUNK_D);
+	light_t* map = chunk->lightmap->map;
+	light_t light = map[index] & RGB_MASK;
+	if (light == 0){
+		return;
+	}
+	remqueue.push(chunk, index, light);
+	map[index] &= ~RGB_MASK;
+	light_changed(chunks, chunk, index);
+}
+
+void RGBLightSolver::solve(){
+	while (!remqueue.empty()){
+		const lightentry entry = remqueue.pop();
+		const uint32_t elight = lanes::spread(entry.light);
+		const uint32_t edec = lanes::dec(elight);
+		// lanes where entry has light to remove
+		const uint32_t eactive = lanes::ge(elight, lanes::ONES);
+
+		for (int side = 0; side < 6; side++) {
+			uint index = entry.index;
+			Chunk* chunk = light_neighbour(chunks, entry.chunk, index, side);
+			if (chunk == nullptr)
+				continue;
+			light_t* map = chunk->lightmap->map;
+			const uint32_t light = lanes::spread(map[index]);
+			const uint32_t lactive = lanes::ge(light, lanes::ONES);
+			// light != 0 && light == entry.light-1
+			const uint32_t removing = lactive & eactive &
+				lanes::ge(light, edec) & lanes::ge(edec, light);
+			// light >= entry.light
+			const uint32_t adding = eactive & ~removing & lanes::ge(light, elight);
+			if (removing){
+				light_t removed = lanes::pack(light & removing);
+				remqueue.push(chunk, index, removed);
+				map[index] &= ~lanes::pack(removing);
+				light_changed(chunks, chunk, index);
+			}
+			if (adding){
+				addqueue.push(chunk, index, lanes::pack(light & adding));
+			}
+		}
+	}
+
+	const Block* const* blockDefs = contentIds->getBlockDefs();
+	while (!addqueue.empty()){
+		const lightentry entry = addqueue.pop();
+		uint32_t elight = lanes::spread(entry.light);
+		// lanes changed after the entry was pushed are skipped: removed
+		// light must not spread, increased one has its own entry
+		uint32_t current = lanes::spread(entry.chunk->lightmap->map[entry.index]);
+		elight &= lanes::ge(elight, current) & lanes::ge(current, elight);
+		// entry.light-1 in lanes, so lanes with light <= 1 are zero
+		const uint32_t edec = lanes::dec(elight);
+		if (edec == 0)
+			continue;
+
+		for (int side = 0; side < 6; side++) {
+			uint index = entry.index;
+			Chunk* chunk = light_neighbour(chunks, entry.chunk, index, side);
+			if (chunk == nullptr)
+				continue;
+			light_t* map = chunk->lightmap->map;
+			const uint32_t light = lanes::spread(map[index]);
+			// light+2 <= entry.light is entry.light-1 > light
+			const uint32_t updating = ~lanes::ge(light, edec) & 0xFFFFFF;
+			if (updating && blockDefs[chunk->voxels[index].id]->lightPassing){
+				light_t updated = lanes::pack(edec & updating);
+				map[index] = (map[index] & ~lanes::pack(updating)) | updated;
+				addqueue.push(chunk, index, updated);
+				light_changed(chunks, chunk, index);
+			}
+		}
+	}
+}
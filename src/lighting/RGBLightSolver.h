@@ -0,0 +1,30 @@
+#ifndef LIGHTING_RGBLIGHTSOLVER_H_
+#define LIGHTING_RGBLIGHTSOLVER_H_
+
+#include "LightQueue.h"
+
+class Chunks;
+class ContentIndices;
+
+/* Propagates R, G and B light channels together in one traversal.
+   Entries hold packed RGB part of light_t, channels are processed as
+   byte lanes of an integer. Results are the same as of three
+   LightSolver's of channels 0, 1, 2 */
+class RGBLightSolver {
+	LightQueue addqueue;
+	LightQueue remqueue;
+	const ContentIndices* const contentIds;
+	Chunks* chunks;
+public:
+	RGBLightSolver(const ContentIndices* contentIds, Chunks* chunks);
+
+	/* Add current light of the voxel to propagate */
+	void add(int x, int y, int z);
+	/* Set emission to channels where it is greater than 1,
+	   light already greater than emission is kept */
+	void add(int x, int y, int z, int r, int g, int b);
+	void remove(int x, int y, int z);
+	void solve();
+};
+
+#endif /* LIGHTING_RGBLIGHTSOLVER_H_ */
@@ -2,12 +2,15 @@
 
 #include <limits.h>
 #include <memory>
+#include <algorithm>
 #include <iostream>
+#include <thread>
 
 #include "../voxels/Block.h"
 #include "../voxels/Chunk.h"
 #include "../voxels/Chunks.h"
 #include "../voxels/ChunksStorage.h"
+#include "../voxels/FarTerrain.h"
 #include "../voxels/WorldGenerator.h"
 #include "../graphics/Mesh.h"
 #include "../lighting/Lighting.h"
@@ -26,7 +29,8 @@ ChunksController::ChunksController(Level* level, uint padding)
 	  chunks(level->chunks), 
 	  lighting(level->lighting), 
 	  padding(padding), 
-	  generator(new WorldGenerator(level->content)) {
+	  generator(new WorldGenerator(level->content)),
+	  lightingThreads(std::max(1U, std::thread::hardware_concurrency())) {
 }
 
 ChunksController::~ChunksController(){
@@ -35,6 +39,7 @@ ChunksController::~ChunksController(){
 
 void ChunksController::update(int64_t maxDuration) {
     int64_t mcstotal = 0;
+    bool idle = false;
 
     for (uint i = 0; i < MAX_WORK_PER_FRAME; i++) {
 		timeutil::Timer timer;
@@ -45,9 +50,79 @@ void ChunksController::update(int64_t maxDuration) {
                 continue;
             }
             mcstotal += mcs;
+        } else {
+            idle = true;
         }
         break;
     }
+    // far terrain uses time left after full chunks loading only
+    if (idle && mcstotal < maxDuration * 1000) {
+        loadFar(maxDuration * 1000 - mcstotal);
+    }
+}
+
+void ChunksController::rebuildFarQueue(glm::ivec2 center) {
+    farCenter = center;
+    farQueue.clear();
+    farQueueIndex = 0;
+    int radius = farDistance;
+    for (int z = -radius; z <= radius; z++) {
+        for (int x = -radius; x <= radius; x++) {
+            if (x * x + z * z <= radius * radius) {
+                farQueue.push_back(center + glm::ivec2(x, z));
+            }
+        }
+    }
+    std::sort(farQueue.begin(), farQueue.end(), 
+        [center](const glm::ivec2& a, const glm::ivec2& b) {
+            glm::ivec2 da = a - center;
+            glm::ivec2 db = b - center;
+            return da.x * da.x + da.y * da.y < db.x * db.x + db.y * db.y;
+        }
+    );
+    // chunks out of range are removed with padding to avoid regeneration
+    // when player moves back and forth near the border
+    level->farTerrain->removeOutside(center.x, center.y, radius + padding);
+}
+
+void ChunksController::loadFar(int64_t maxDuration) {
+    FarTerrain* farTerrain = level->farTerrain;
+    uint distance = level->settings.chunks.farDistance;
+    if (distance == 0) {
+        if (farDistance) {
+            farDistance = 0;
+            farTerrain->clear();
+        }
+        return;
+    }
+    glm::ivec2 center (chunks->ox + chunks->w / 2, chunks->oz + chunks->d / 2);
+    if (distance != farDistance || center != farCenter) {
+        farDistance = distance;
+        rebuildFarQueue(center);
+    }
+
+    int64_t mcstotal = 0;
+    while (farQueueIndex < farQueue.size()) {
+        timeutil::Timer timer;
+        glm::ivec2 pos = farQueue[farQueueIndex++];
+        if (farTerrain->get(pos.x, pos.y)) {
+            continue;
+        }
+        Chunk* chunk = chunks->getChunk(pos.x, pos.y);
+        if (chunk && chunk->isLighted()) {
+            continue;
+        }
+        auto farChunk = std::make_shared<FarChunk>(pos.x, pos.y);
+        generator->generateSurface(farChunk->columns.get(), 
+                                   pos.x, pos.y, level->world->seed);
+        farChunk->updateHeights();
+        farTerrain->store(farChunk);
+
+        mcstotal += timer.stop();
+        if (mcstotal >= maxDuration) {
+            break;
+        }
+    }
 }
 
 bool ChunksController::loadVisible(){
@@ -58,6 +133,8 @@ bool ChunksController::loadVisible(){
 	int nearX = 0;
 	int nearZ = 0;
 	int minDistance = ((w-padding*2)/2)*((w-padding*2)/2);
+	std::vector<std::shared_ptr<Chunk>> ready;
+	std::vector<std::shared_ptr<Chunk>> batch;
 	for (uint z = padding; z < d-padding; z++){
 		for (uint x = padding; x < w-padding; x++){
 			int index = z * w + x;
@@ -71,13 +148,12 @@ bool ChunksController::loadVisible(){
 					}
 				}
 				chunk->surrounding = surrounding;
-				if (surrounding == MIN_SURROUNDING && !chunk->isLighted()) {
+				if (surrounding == MIN_SURROUNDING && !chunk->isLighted() &&
+					ready.size() < lightingThreads) {
 					if (!chunk->isLoadedLights()) {
-						lighting->buildSkyLight(chunk->x, chunk->z);
-					    lighting->onChunkLoaded(chunk->x, chunk->z);
-                    }
-					chunk->setLighted(true);
-					return true;
+						batch.push_back(chunk);
+					}
+					ready.push_back(chunk);
 				}
 				continue;
 			}
@@ -92,6 +168,16 @@ bool ChunksController::loadVisible(){
 		}
 	}
 
+	if (!ready.empty()) {
+		lighting->buildChunks(batch, lightingThreads);
+		// reduced detail chunks are removed by the renderer when
+		// full chunks meshes are built
+		for (auto& chunk : ready) {
+			chunk->setLighted(true);
+		}
+		return true;
+	}
+
 	int index = nearZ * w + nearX;
 	std::shared_ptr<Chunk> chunk = chunks->chunks[index];
 	if (chunk != nullptr) {
@@ -1,6 +1,8 @@
 #ifndef VOXELS_CHUNKSCONTROLLER_H_
 #define VOXELS_CHUNKSCONTROLLER_H_
 
+#include <vector>
+#include <glm/glm.hpp>
 #include "../typedefs.h"
 
 class Level;
@@ -16,12 +18,25 @@ private:
 	Lighting* lighting;
 	uint padding;
 	WorldGenerator* generator;
+	/* Max chunks lighted by one loadVisible call in parallel */
+	uint lightingThreads;
 
 	/* Average measured microseconds duration of loadVisible call */
 	int64_t avgDurationMcs = 1000;
 
-	/* Process one chunk: load it or calculate lights for it */
+	/* Far terrain chunks positions sorted by distance to farCenter */
+	std::vector<glm::ivec2> farQueue;
+	size_t farQueueIndex = 0;
+	glm::ivec2 farCenter {};
+	uint farDistance = 0;
+
+	/* Load one chunk or calculate lights for ready chunks batch */
 	bool loadVisible();
+
+	/* Generate far terrain chunks nearest-first
+	   @param maxDuration microseconds available */
+	void loadFar(int64_t maxDuration);
+	void rebuildFarQueue(glm::ivec2 center);
 public:
 	ChunksController(Level* level, uint padding);
 	~ChunksController();
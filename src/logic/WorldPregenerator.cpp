@@ -0,0 +1,196 @@
+#include "WorldPregenerator.h"
+
+#include <atomic>
+#include <thread>
+#include <future>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "../voxels/Chunk.h"
+#include "../voxels/Chunks.h"
+#include "../voxels/WorldGenerator.h"
+#include "../lighting/Lighting.h"
+#include "../lighting/Lightmap.h"
+#include "../files/WorldFiles.h"
+#include "../world/World.h"
+#include "../maths/voxmaths.h"
+#include "../util/timeutil.h"
+
+struct pregen_job {
+    int x, z;
+    /* chunk will be saved (tile padding chunks are used for lighting only) */
+    bool inner;
+    std::unique_ptr<ubyte[]> data;
+    std::unique_ptr<light_t[]> lights;
+    std::shared_ptr<Chunk> chunk;
+};
+
+struct pregen_tile {
+    /* padded area: x, z - first chunk coordinates; w, d - size in chunks */
+    int x, z;
+    int w, d;
+    std::vector<pregen_job> jobs;
+};
+
+WorldPregenerator::WorldPregenerator(World* world,
+                                     const Content* content,
+                                     uint threads)
+    : world(world),
+      content(content),
+      threads(threads),
+      generator(std::make_unique<WorldGenerator>(content)) {
+    if (this->threads == 0) {
+        this->threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+}
+
+WorldPregenerator::~WorldPregenerator() {
+}
+
+uint WorldPregenerator::getThreadsCount() const {
+    return threads;
+}
+
+void WorldPregenerator::prepare(pregen_tile* tile) {
+    WorldFiles* wfile = world->wfile;
+    for (auto& job : tile->jobs) {
+        job.data.reset(wfile->getChunk(job.x, job.z));
+        job.lights.reset(wfile->getLights(job.x, job.z));
+    }
+}
+
+void WorldPregenerator::build(pregen_tile* tile) {
+    const int seed = world->seed;
+    std::atomic<size_t> nextIndex (0);
+    auto worker = [=, &nextIndex]() {
+        size_t index;
+        while ((index = nextIndex++) < tile->jobs.size()) {
+            pregen_job& job = tile->jobs[index];
+            auto chunk = std::make_shared<Chunk>(job.x, job.z);
+            if (job.data) {
+                chunk->decode(job.data.get());
+                chunk->setLoaded(true);
+                job.data.reset();
+            } else {
+                generator->generate(chunk->voxels, job.x, job.z, seed);
+                chunk->setUnsaved(true);
+            }
+            if (job.lights) {
+                chunk->lightmap->set(job.lights.release());
+                chunk->setLoadedLights(true);
+            }
+            chunk->updateHeights();
+            job.chunk = chunk;
+        }
+    };
+    std::vector<std::thread> workers;
+    for (uint i = 1; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+}
+
+void WorldPregenerator::finish(pregen_tile* tile) {
+    WorldFiles* wfile = world->wfile;
+    Chunks chunks(tile->w, tile->d, tile->x, tile->z, wfile, nullptr, content);
+    for (auto& job : tile->jobs) {
+        chunks.putChunk(job.chunk);
+    }
+
+    /* Lighting */ {
+        timeutil::Timer timer;
+        Lighting lighting(content, &chunks);
+        std::vector<std::shared_ptr<Chunk>> batch;
+        for (auto& job : tile->jobs) {
+            if (!job.chunk->isLoadedLights()) {
+                lighting.prebuildSkyLight(job.x, job.z);
+                batch.push_back(job.chunk);
+            }
+        }
+        lighting.buildChunks(batch, threads);
+        for (auto& job : tile->jobs) {
+            job.chunk->setLighted(true);
+        }
+        lightingMcs += timer.stop();
+    }
+
+    /* Saving */ {
+        timeutil::Timer timer;
+        for (auto& job : tile->jobs) {
+            Chunk* chunk = job.chunk.get();
+            if (!job.inner)
+                continue;
+            bool lightsUnsaved = !chunk->isLoadedLights() && wfile->doWriteLights;
+            if (!chunk->isUnsaved() && !lightsUnsaved)
+                continue;
+            wfile->put(chunk);
+            saved++;
+            if (!chunk->isLoaded()) {
+                generated++;
+            }
+        }
+        wfile->write(nullptr, content);
+        // written regions are not needed anymore
+        wfile->regions.clear();
+        wfile->lights.clear();
+        savingMcs += timer.stop();
+    }
+}
+
+void WorldPregenerator::generate(int radius) {
+    const int size = PREGEN_TILE_SIZE;
+    std::vector<glm::ivec2> tiles;
+    for (int tz = floordiv(-radius, size); tz <= floordiv(radius, size); tz++) {
+        for (int tx = floordiv(-radius, size); tx <= floordiv(radius, size); tx++) {
+            tiles.push_back(glm::ivec2(tx, tz));
+        }
+    }
+
+    auto createTile = [=](glm::ivec2 coord) {
+        int x1 = std::max(coord.x * size, -radius);
+        int z1 = std::max(coord.y * size, -radius);
+        int x2 = std::min(coord.x * size + size - 1, radius);
+        int z2 = std::min(coord.y * size + size - 1, radius);
+
+        auto tile = std::make_unique<pregen_tile>();
+        tile->x = x1 - 1;
+        tile->z = z1 - 1;
+        tile->w = x2 - x1 + 3;
+        tile->d = z2 - z1 + 3;
+        tile->jobs.resize(tile->w * tile->d);
+        for (int z = 0; z < tile->d; z++) {
+            for (int x = 0; x < tile->w; x++) {
+                pregen_job& job = tile->jobs[z * tile->w + x];
+                job.x = tile->x + x;
+                job.z = tile->z + z;
+                job.inner = x > 0 && z > 0 && x < tile->w-1 && z < tile->d-1;
+            }
+        }
+        prepare(tile.get());
+        return tile;
+    };
+
+    auto current = createTile(tiles[0]);
+    auto building = std::async(std::launch::async,
+                               &WorldPregenerator::build, this, current.get());
+    for (size_t i = 0; i < tiles.size(); i++) {
+        timeutil::Timer timer;
+        building.get();
+        buildWaitMcs += timer.stop();
+
+        std::unique_ptr<pregen_tile> next = nullptr;
+        if (i + 1 < tiles.size()) {
+            // next tile is generating while current one is lighted and saved
+            next = createTile(tiles[i+1]);
+            building = std::async(std::launch::async,
+                                  &WorldPregenerator::build, this, next.get());
+        }
+        finish(current.get());
+        current = std::move(next);
+    }
+    world->wfile->write(world, content);
+}
@@ -0,0 +1,50 @@
+#ifndef LOGIC_WORLDPREGENERATOR_H_
+#define LOGIC_WORLDPREGENERATOR_H_
+
+#include <memory>
+#include "../typedefs.h"
+
+class World;
+class Content;
+class WorldGenerator;
+struct pregen_tile;
+
+/* Headless chunks generation, lighting and saving (used by --pregen).
+   Area is processed by tiles of PREGEN_TILE_SIZE x PREGEN_TILE_SIZE chunks
+   padded with one ring of neighbour chunks needed for lighting.
+   Tile chunks are generated by worker threads while the main thread
+   lights and saves previous tile, so only two tiles are held in memory. */
+class WorldPregenerator {
+    World* world;
+    const Content* content;
+    uint threads;
+    std::unique_ptr<WorldGenerator> generator;
+
+    /* Read existing chunks data (main thread only) */
+    void prepare(pregen_tile* tile);
+    /* Create, decode or generate tile chunks using worker threads */
+    void build(pregen_tile* tile);
+    /* Calculate lights and put tile chunks to world files */
+    void finish(pregen_tile* tile);
+public:
+    static const int PREGEN_TILE_SIZE = 16;
+
+    /* Stats (microseconds for timings) */
+    size_t generated = 0;
+    size_t saved = 0;
+    int64_t buildWaitMcs = 0;
+    int64_t lightingMcs = 0;
+    int64_t savingMcs = 0;
+
+    /* @param threads generator threads count (0 - hardware concurrency) */
+    WorldPregenerator(World* world, const Content* content, uint threads);
+    ~WorldPregenerator();
+
+    /* Generate, light and save all chunks in square radius
+       around chunk 0,0 (radius in chunks) */
+    void generate(int radius);
+
+    uint getThreadsCount() const;
+};
+
+#endif // LOGIC_WORLDPREGENERATOR_H_
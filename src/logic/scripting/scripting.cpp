@@ -8,6 +8,7 @@
 #include "../../files/files.h"
 #include "../../util/timeutil.h"
 #include "../../world/Level.h"
+#include "../../lighting/Lighting.h"
 #include "../../voxels/Block.h"
 #include "../../items/ItemDef.h"
 #include "../../logic/BlocksController.h"
@@ -50,7 +51,16 @@ bool rename_global(lua_State* L, const char* src, const char* dst) {
 }
 
 int call_func(lua_State* L, int argc, const std::string& name) {
-    if (lua_pcall(L, argc, LUA_MULTRET, 0)) {
+    // blocks set by the script are lighted together when it returns
+    Lighting* lighting = level ? level->lighting : nullptr;
+    if (lighting) {
+        lighting->beginTransaction();
+    }
+    int status = lua_pcall(L, argc, LUA_MULTRET, 0);
+    if (lighting) {
+        lighting->endTransaction();
+    }
+    if (status) {
         std::cerr << "Lua error in " << name << ": ";
         std::cerr << lua_tostring(L,-1) << std::endl;
         return 0;
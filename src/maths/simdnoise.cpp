@@ -0,0 +1,238 @@
+// FastNoiseLite implementation lives in this translation unit
+// to make its tables and helpers reachable for vector kernels
+#define FNL_IMPL
+#include "FastNoiseLite.h"
+#include "simdnoise.h"
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#   define SIMDNOISE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   ifdef __SSE4_1__
+#       include <smmintrin.h>
+#   endif
+#   define SIMDNOISE_SSE2
+#endif
+
+namespace {
+#if defined(SIMDNOISE_SSE2)
+    struct lanes_t {
+        typedef __m128 f;
+        typedef __m128i i;
+        static const int COUNT = 4;
+
+        static inline f load(const float* src) {return _mm_loadu_ps(src);}
+        static inline void store(float* dst, f v) {_mm_storeu_ps(dst, v);}
+        static inline f set(float v) {return _mm_set1_ps(v);}
+        static inline i iset(int v) {return _mm_set1_epi32(v);}
+
+        static inline f add(f a, f b) {return _mm_add_ps(a, b);}
+        static inline f sub(f a, f b) {return _mm_sub_ps(a, b);}
+        static inline f mul(f a, f b) {return _mm_mul_ps(a, b);}
+        static inline f cmpgt(f a, f b) {return _mm_cmpgt_ps(a, b);}
+
+        static inline f select(f mask, f a, f b) {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+        static inline i iselect(f mask, i a, i b) {
+            __m128i m = _mm_castps_si128(mask);
+            return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+        }
+
+        static inline i iadd(i a, i b) {return _mm_add_epi32(a, b);}
+        static inline i ixor(i a, i b) {return _mm_xor_si128(a, b);}
+        static inline i iand(i a, i b) {return _mm_and_si128(a, b);}
+        static inline i imul(i a, i b) {
+#       ifdef __SSE4_1__
+            return _mm_mullo_epi32(a, b);
+#       else
+            __m128i even = _mm_mul_epu32(a, b);
+            __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#       endif
+        }
+        // hash ^= hash >> 15
+        static inline i hashmix(i h) {return _mm_xor_si128(h, _mm_srai_epi32(h, 15));}
+
+        // same as _fnlFastFloor: (int)f for f >= 0, (int)f - 1 otherwise
+        static inline i fastfloor(f v) {
+            __m128i t = _mm_cvttps_epi32(v);
+            return _mm_add_epi32(t, _mm_castps_si128(_mm_cmplt_ps(v, _mm_setzero_ps())));
+        }
+        static inline f tofloat(i v) {return _mm_cvtepi32_ps(v);}
+
+        static inline f gather(const float* table, i indices) {
+            alignas(16) int32_t idx[COUNT];
+            _mm_store_si128((__m128i*)idx, indices);
+            return _mm_setr_ps(table[idx[0]], table[idx[1]],
+                               table[idx[2]], table[idx[3]]);
+        }
+    };
+#elif defined(SIMDNOISE_AVX2)
+    struct lanes_t {
+        typedef __m256 f;
+        typedef __m256i i;
+        static const int COUNT = 8;
+
+        static inline f load(const float* src) {return _mm256_loadu_ps(src);}
+        static inline void store(float* dst, f v) {_mm256_storeu_ps(dst, v);}
+        static inline f set(float v) {return _mm256_set1_ps(v);}
+        static inline i iset(int v) {return _mm256_set1_epi32(v);}
+
+        static inline f add(f a, f b) {return _mm256_add_ps(a, b);}
+        static inline f sub(f a, f b) {return _mm256_sub_ps(a, b);}
+        static inline f mul(f a, f b) {return _mm256_mul_ps(a, b);}
+        static inline f cmpgt(f a, f b) {return _mm256_cmp_ps(a, b, _CMP_GT_OQ);}
+
+        static inline f select(f mask, f a, f b) {return _mm256_blendv_ps(b, a, mask);}
+        static inline i iselect(f mask, i a, i b) {
+            return _mm256_blendv_epi8(b, a, _mm256_castps_si256(mask));
+        }
+
+        static inline i iadd(i a, i b) {return _mm256_add_epi32(a, b);}
+        static inline i ixor(i a, i b) {return _mm256_xor_si256(a, b);}
+        static inline i iand(i a, i b) {return _mm256_and_si256(a, b);}
+        static inline i imul(i a, i b) {return _mm256_mullo_epi32(a, b);}
+        static inline i hashmix(i h) {return _mm256_xor_si256(h, _mm256_srai_epi32(h, 15));}
+
+        static inline i fastfloor(f v) {
+            __m256i t = _mm256_cvttps_epi32(v);
+            __m256 neg = _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ);
+            return _mm256_add_epi32(t, _mm256_castps_si256(neg));
+        }
+        static inline f tofloat(i v) {return _mm256_cvtepi32_ps(v);}
+
+        static inline f gather(const float* table, i indices) {
+            return _mm256_i32gather_ps(table, indices, 4);
+        }
+    };
+#endif
+
+#if defined(SIMDNOISE_SSE2) || defined(SIMDNOISE_AVX2)
+    static_assert(sizeof(FNLfloat) == sizeof(float),
+                  "vector kernels require single precision FNLfloat");
+
+    typedef lanes_t V;
+
+    // vector version of _fnlGradCoord2D
+    inline V::f grad_coord(V::i seed, V::i xPrimed, V::i yPrimed, V::f xd, V::f yd) {
+        V::i hash = V::ixor(V::ixor(seed, xPrimed), yPrimed);
+        hash = V::imul(hash, V::iset(0x27d4eb2d));
+        hash = V::hashmix(hash);
+        hash = V::iand(hash, V::iset(127 << 1));
+        V::f gx = V::gather(GRADIENTS_2D, hash);
+        V::f gy = V::gather(GRADIENTS_2D+1, hash);
+        return V::add(V::mul(xd, gx), V::mul(yd, gy));
+    }
+
+    // vector version of _fnlSingleSimplex2D (keeping operations order)
+    inline V::f single_simplex(V::i seed, V::f x, V::f y) {
+        const float SQRT3 = 1.7320508075688772935274463415059f;
+        const float G2 = (3 - SQRT3) / 6;
+        const V::f zero = V::set(0.0f);
+        const V::f half = V::set(0.5f);
+
+        V::i i = V::fastfloor(x);
+        V::i j = V::fastfloor(y);
+        V::f xi = V::sub(x, V::tofloat(i));
+        V::f yi = V::sub(y, V::tofloat(j));
+
+        V::f t = V::mul(V::add(xi, yi), V::set(G2));
+        V::f x0 = V::sub(xi, t);
+        V::f y0 = V::sub(yi, t);
+
+        i = V::imul(i, V::iset(PRIME_X));
+        j = V::imul(j, V::iset(PRIME_Y));
+
+        V::f a = V::sub(V::sub(half, V::mul(x0, x0)), V::mul(y0, y0));
+        V::f a2 = V::mul(a, a);
+        V::f n0 = V::mul(V::mul(a2, a2), grad_coord(seed, i, j, x0, y0));
+        n0 = V::select(V::cmpgt(a, zero), n0, zero);
+
+        V::f c = V::add(
+            V::mul(V::set((float)(2 * (1 - 2 * G2) * (1 / G2 - 2))), t),
+            V::add(V::set((float)(-2 * (1 - 2 * G2) * (1 - 2 * G2))), a)
+        );
+        V::f x2 = V::add(x0, V::set(2 * (float)G2 - 1));
+        V::f y2 = V::add(y0, V::set(2 * (float)G2 - 1));
+        V::f c2 = V::mul(c, c);
+        V::f n2 = V::mul(V::mul(c2, c2), grad_coord(
+            seed, V::iadd(i, V::iset(PRIME_X)), V::iadd(j, V::iset(PRIME_Y)), x2, y2));
+        n2 = V::select(V::cmpgt(c, zero), n2, zero);
+
+        // both branches of 'y0 > x0' condition are computed and blended
+        V::f upper = V::cmpgt(y0, x0);
+        V::f x1 = V::select(upper, V::add(x0, V::set(G2)), V::add(x0, V::set(G2 - 1)));
+        V::f y1 = V::select(upper, V::add(y0, V::set(G2 - 1)), V::add(y0, V::set(G2)));
+        V::i i1 = V::iselect(upper, i, V::iadd(i, V::iset(PRIME_X)));
+        V::i j1 = V::iselect(upper, V::iadd(j, V::iset(PRIME_Y)), j);
+        V::f b = V::sub(V::sub(half, V::mul(x1, x1)), V::mul(y1, y1));
+        V::f b2 = V::mul(b, b);
+        V::f n1 = V::mul(V::mul(b2, b2), grad_coord(seed, i1, j1, x1, y1));
+        n1 = V::select(V::cmpgt(b, zero), n1, zero);
+
+        return V::mul(V::add(V::add(n0, n1), n2), V::set(99.83685446303647f));
+    }
+
+    /* @return number of processed points (multiple of lanes count) */
+    size_t simplex2D(fnl_state* state,
+                     const float* xs, const float* ys,
+                     float* dst, size_t count) {
+        const FNLfloat SQRT3 = (FNLfloat)1.7320508075688772935274463415059;
+        const FNLfloat F2 = 0.5f * (SQRT3 - 1);
+        const V::f frequency = V::set(state->frequency);
+        const V::f skew = V::set(F2);
+        const V::i seed = V::iset(state->seed);
+
+        size_t index = 0;
+        for (; index + V::COUNT <= count; index += V::COUNT) {
+            // _fnlTransformNoiseCoordinate2D
+            V::f x = V::mul(V::load(xs+index), frequency);
+            V::f y = V::mul(V::load(ys+index), frequency);
+            V::f t = V::mul(V::add(x, y), skew);
+            x = V::add(x, t);
+            y = V::add(y, t);
+            V::store(dst+index, single_simplex(seed, x, y));
+        }
+        return index;
+    }
+#endif
+
+    inline bool is_vectorizable(const fnl_state* state) {
+        if (state->noise_type != FNL_NOISE_OPENSIMPLEX2)
+            return false;
+        switch (state->fractal_type) {
+            case FNL_FRACTAL_FBM:
+            case FNL_FRACTAL_RIDGED:
+            case FNL_FRACTAL_PINGPONG:
+                return false;
+            default:
+                return true;
+        }
+    }
+}
+
+int simdnoise::lanes() {
+#if defined(SIMDNOISE_SSE2) || defined(SIMDNOISE_AVX2)
+    return V::COUNT;
+#else
+    return 1;
+#endif
+}
+
+void simdnoise::noise2D(fnl_state* state,
+                        const FNLfloat* xs, const FNLfloat* ys,
+                        float* dst, size_t count) {
+    size_t index = 0;
+#if defined(SIMDNOISE_SSE2) || defined(SIMDNOISE_AVX2)
+    if (is_vectorizable(state)) {
+        index = simplex2D(state, xs, ys, dst, count);
+    }
+#endif
+    // tail and non-vectorized configurations
+    for (; index < count; index++) {
+        dst[index] = fnlGetNoise2D(state, xs[index], ys[index]);
+    }
+}
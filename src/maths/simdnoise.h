@@ -0,0 +1,28 @@
+#ifndef MATHS_SIMDNOISE_H_
+#define MATHS_SIMDNOISE_H_
+
+#include <stdlib.h>
+#include "FastNoiseLite.h"
+
+/* Batched FastNoiseLite sampling.
+   FNL_NOISE_OPENSIMPLEX2 2D noise (without fractal) is evaluated
+   with SSE2 (4 lanes) or AVX2 (8 lanes) depending on target,
+   other noise configurations fall back to scalar fnlGetNoise* calls.
+
+   Vector kernel replicates scalar operations order, so results are
+   expected to be bit-identical to fnlGetNoise2D. TOLERANCE is the
+   guaranteed max absolute difference, it covers compilers contracting
+   scalar path to FMA instructions (-march=native, /fp:contract). */
+namespace simdnoise {
+    constexpr float TOLERANCE = 1e-5f;
+
+    /* Number of lanes used by 2D kernel (1 if SIMD is not available) */
+    int lanes();
+
+    /* dst[i] = fnlGetNoise2D(state, xs[i], ys[i]) */
+    void noise2D(fnl_state* state,
+                 const FNLfloat* xs, const FNLfloat* ys,
+                 float* dst, size_t count);
+}
+
+#endif // MATHS_SIMDNOISE_H_
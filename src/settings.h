@@ -30,6 +30,9 @@ struct ChunksSettings {
 	uint loadDistance = 22;
 	/* Buffer zone where chunks are not unloading (chunk is unit)*/
 	uint padding = 2;
+	/* Radius of reduced detail terrain drawn where chunks are not 
+	   loaded yet (chunk is unit), 0 - disabled */
+	uint farDistance = 0;
 };
 
 struct CameraSettings {
@@ -51,6 +54,14 @@ struct GraphicsSettings {
 	bool backlight = true;
 	/* Enable chunks frustum culling */
 	bool frustumCulling = true;
+	/* Skip chunks sections not connected with the camera section through
+	   not opaque blocks (caves hidden behind terrain) */
+	bool caveCulling = true;
+	/* Merge coplanar full blocks faces with the same texture and light */
+	bool greedyMeshing = true;
+	/* Save chunks meshes in the world folder to skip meshing of
+	   unchanged chunks when they are loaded again */
+	bool meshCache = false;
 	int skyboxResolution = 64 + 32;
 };
 
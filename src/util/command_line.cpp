@@ -1,10 +1,29 @@
 #include "command_line.h"
 
 #include <filesystem>
+#include <functional>
 
 namespace fs = std::filesystem;
 
-bool parse_cmdline(int argc, char** argv, EnginePaths& paths) {
+static int parse_int(const std::string& token) {
+	try {
+		return std::stoi(token);
+	} catch (const std::logic_error& err) {
+		throw std::runtime_error("integer expected, got '"+token+"'");
+	}
+}
+
+static uint64_t parse_seed(const std::string& token) {
+	try {
+		return std::stoull(token);
+	} catch (const std::logic_error& err) {
+		return std::hash<std::string>()(token);
+	}
+}
+
+bool parse_cmdline(int argc, char** argv, 
+				   EnginePaths& paths, 
+				   CommandLineOptions& options) {
 	ArgsReader reader(argc, argv);
 	reader.skip();
 	while (reader.hasNext()) {
@@ -24,10 +43,33 @@ bool parse_cmdline(int argc, char** argv, EnginePaths& paths) {
 				}
 				paths.setUserfiles(fs::path(token));
 				std::cout << "userfiles folder: " << token << std::endl;
+			} else if (token == "--pregen") {
+				options.mode = runmode::pregen;
+				options.world = reader.next();
+				options.seed = parse_seed(reader.next());
+				options.radius = parse_int(reader.next());
+				if (options.radius < 0) {
+					throw std::runtime_error("negative pre-generation radius");
+				}
+			} else if (token == "--bench") {
+				options.mode = runmode::benchmark;
+				options.benchmark = reader.next();
+			} else if (token == "--threads") {
+				int threads = parse_int(reader.next());
+				if (threads < 0) {
+					throw std::runtime_error("negative threads count");
+				}
+				options.threads = threads;
 			} else if (token == "--help" || token == "-h") {
 				std::cout << "VoxelEngine command-line arguments:" << std::endl;
 				std::cout << " --res [path] - set resources directory" << std::endl;
 				std::cout << " --dir [path] - set userfiles directory" << std::endl;
+				std::cout << " --pregen [world] [seed] [radius] - generate, light and save" << std::endl;
+				std::cout << "     chunks in radius around 0,0 without window" << std::endl;
+				std::cout << "     (seed of existing world is kept)" << std::endl;
+				std::cout << " --threads [count] - set worker threads count" << std::endl;
+				std::cout << " --bench [name] - run benchmark without window" << std::endl;
+				std::cout << "     (generator, lightsolver, lighting, meshing, culling)" << std::endl;
 				return false;
 			} else {
 				std::cerr << "unknown argument " << token << std::endl;
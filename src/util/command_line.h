@@ -4,6 +4,7 @@
 #include <string>
 #include <iostream>
 #include <stdexcept>
+#include "../typedefs.h"
 #include "../files/engine_paths.h"
 
 class ArgsReader {
@@ -35,7 +36,31 @@ public:
 	}
 };
 
+enum class runmode {
+	engine,
+	/* headless world pre-generation (--pregen) */
+	pregen,
+	/* headless benchmark (--bench) */
+	benchmark
+};
+
+struct CommandLineOptions {
+	runmode mode = runmode::engine;
+	/* 0 - use hardware concurrency */
+	uint threads = 0;
+
+	/* --pregen arguments */
+	std::string world;
+	uint64_t seed = 0;
+	int radius = 0;
+
+	/* --bench argument */
+	std::string benchmark;
+};
+
 /* @return false if engine start can*/
-extern bool parse_cmdline(int argc, char** argv, EnginePaths& paths);
+extern bool parse_cmdline(int argc, char** argv, 
+						  EnginePaths& paths, 
+						  CommandLineOptions& options);
 
 #endif // UTIL_COMMAND_LINE_H_
\ No newline at end of file
@@ -9,6 +9,7 @@
 
 #ifdef WIN32
 #include <Windows.h>
+#include <psapi.h>
 
 #include "./stringutil.h"
 
@@ -28,7 +29,16 @@ std::string platform::detect_locale() {
     return util::wstr2str_utf8(preferredLocaleName).replace(2, 1, "_").substr(0, 5);
 }
 
+size_t platform::get_peak_memory() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
 #else
+#include <sys/resource.h>
 
 void platform::configure_encoding(){
 }
@@ -41,4 +51,17 @@ std::string platform::detect_locale() {
     return preferredLocaleName.substr(0, 5);
 }
 
+size_t platform::get_peak_memory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) {
+        return 0;
+    }
+#   ifdef __APPLE__
+    return usage.ru_maxrss;
+#   else
+    // kilobytes on Linux
+    return (size_t)usage.ru_maxrss * 1024;
+#   endif
+}
+
 #endif
\ No newline at end of file
@@ -2,11 +2,14 @@
 #define UTIL_PLATFORM_H_
 
 #include <string>
+#include <stddef.h>
 
 namespace platform {
     extern void configure_encoding();
     // @return environment locale in ISO format ll_CC
     extern std::string detect_locale();
+    // @return peak resident memory of the process in bytes (0 if unknown)
+    extern size_t get_peak_memory();
 }
 
 #endif // UTIL_PLATFORM_H_
\ No newline at end of file
@@ -13,18 +13,130 @@
 #include "files/settings_io.h"
 #include "files/engine_paths.h"
 #include "util/command_line.h"
+#include "util/timeutil.h"
+#include "world/World.h"
+#include "files/WorldFiles.h"
+#include "content/Content.h"
+#include "content/ContentLUT.h"
+#include "content/ContentPack.h"
+#include "content/ContentLoader.h"
+#include "logic/WorldPregenerator.h"
+#include "logic/scripting/scripting.h"
+#include "benchmarks/benchmarks.h"
 
 #define SETTINGS_FILE "settings.toml"
 #define CONTROLS_FILE "controls.json"
 
 namespace fs = std::filesystem;
 
+/* Load content packs without engine (scripting must be initialized) */
+static Content* load_content(std::vector<ContentPack>& packs) {
+	ContentBuilder builder;
+	setup_definitions(&builder);
+	for (auto& pack : packs) {
+		ContentLoader loader(&pack);
+		loader.load(&builder);
+	}
+	return builder.build();
+}
+
+static int run_pregen(EnginePaths& paths, const CommandLineOptions& options) {
+	fs::path folder = fs::u8path(options.world);
+	fs::create_directories(folder);
+
+	scripting::initialize(nullptr);
+	std::vector<ContentPack> packs;
+	auto packNames = ContentPack::worldPacksList(folder);
+	ContentPack::readPacks(&paths, packs, packNames, folder);
+	std::unique_ptr<Content> content (load_content(packs));
+	std::unique_ptr<ContentLUT> lut (World::checkIndices(folder, content.get()));
+	if (lut && (lut->hasContentReorder() || lut->hasMissingContent())) {
+		std::cerr << "world content does not match installed packs, ";
+		std::cerr << "open the world in the engine first" << std::endl;
+		scripting::close();
+		return EXIT_FAILURE;
+	}
+
+	EngineSettings settings;
+	World world(folder.filename().u8string(), folder, options.seed, 
+				settings, content.get(), packs);
+	if (world.wfile->readWorldInfo(&world) && world.seed != options.seed) {
+		std::cout << "existing world seed is used: " << world.seed << std::endl;
+	}
+
+	WorldPregenerator pregenerator(&world, content.get(), options.threads);
+	int side = options.radius * 2 + 1;
+	std::cout << "-- pre-generating " << side << "x" << side << " chunks using ";
+	std::cout << pregenerator.getThreadsCount() << " thread(s)" << std::endl;
+
+	timeutil::Timer timer;
+	pregenerator.generate(options.radius);
+	int64_t mcs = timer.stop();
+	scripting::close();
+
+	double seconds = mcs / 1e6;
+	std::cout << "-- done in " << seconds << " s" << std::endl;
+	std::cout << "generated: " << pregenerator.generated << " chunks, ";
+	std::cout << "saved: " << pregenerator.saved << " chunks" << std::endl;
+	std::cout << "speed: " << pregenerator.saved / seconds << " chunks/s" << std::endl;
+	std::cout << "waiting for generator: " << pregenerator.buildWaitMcs / 1000 << " ms, ";
+	std::cout << "lighting: " << pregenerator.lightingMcs / 1000 << " ms, ";
+	std::cout << "saving: " << pregenerator.savingMcs / 1000 << " ms" << std::endl;
+	std::cout << "peak memory: " << platform::get_peak_memory() / (1024 * 1024);
+	std::cout << " MiB" << std::endl;
+	return EXIT_SUCCESS;
+}
+
+static int run_benchmark(EnginePaths& paths, const CommandLineOptions& options) {
+	fs::path contentFolder = paths.getResources()/fs::path("content");
+	std::vector<ContentPack> packs {ContentPack::read(contentFolder/fs::path("base"))};
+
+	scripting::initialize(nullptr);
+	std::unique_ptr<Content> content (load_content(packs));
+	scripting::close();
+
+	std::cout << "-- running benchmark '" << options.benchmark << "'" << std::endl;
+	bool success;
+	if (options.benchmark == "generator") {
+		success = benchmarks::generator(content.get());
+	} else if (options.benchmark == "lightsolver") {
+		success = benchmarks::lightsolver(content.get());
+	} else if (options.benchmark == "lighting") {
+		success = benchmarks::lighting(content.get());
+	} else if (options.benchmark == "meshing") {
+		success = benchmarks::meshing(content.get());
+	} else if (options.benchmark == "culling") {
+		success = benchmarks::culling(content.get());
+	} else {
+		std::cerr << "unknown benchmark " << options.benchmark << std::endl;
+		return EXIT_FAILURE;
+	}
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char** argv) {
 	EnginePaths paths;
-	if (!parse_cmdline(argc, argv, paths))
+	CommandLineOptions options;
+	if (!parse_cmdline(argc, argv, paths, options))
 		return EXIT_SUCCESS;
 
 	platform::configure_encoding();
+	if (options.mode == runmode::pregen) {
+		try {
+			return run_pregen(paths, options);
+		} catch (const std::runtime_error& err) {
+			std::cerr << "pre-generation failed: " << err.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	if (options.mode == runmode::benchmark) {
+		try {
+			return run_benchmark(paths, options);
+		} catch (const std::runtime_error& err) {
+			std::cerr << "benchmark failed: " << err.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
     fs::path userfiles = paths.getUserfiles();
 	try {
 	    EngineSettings settings;
@@ -0,0 +1,409 @@
+#include "BaseStages.h"
+#include "voxel.h"
+#include "Block.h"
+#include "WorldGenerator.h"
+#include "GeneratorStage.h"
+#include "FarTerrain.h"
+
+#include <time.h>
+#include <stdexcept>
+#include <math.h>
+#include <algorithm>
+#include "../maths/FastNoiseLite.h"
+#include "../maths/simdnoise.h"
+
+#include "../content/Content.h"
+#include "../maths/voxmaths.h"
+
+// TODO: do something with long conditions + move magic numbers to constants
+
+const int SEA_LEVEL = 55;
+
+enum class MAPS{
+    SAND,
+    TREE,
+    CLIFF,
+    HEIGHT
+};
+#define MAPS_LEN 4
+
+class PseudoRandom {
+    unsigned short seed;
+public:
+    PseudoRandom(){
+        seed = (unsigned short)time(0);
+    }
+
+    int rand(){
+        seed = (seed + 0x7ed5 + (seed << 6));
+        seed = (seed ^ 0xc23c ^ (seed >> 9));
+        seed = (seed + 0x1656 + (seed << 3));
+        seed = ((seed + 0xa264) ^ (seed << 4));
+        seed = (seed + 0xfd70 - (seed << 3));
+        seed = (seed ^ 0xba49 ^ (seed >> 8));
+
+        return (int)seed;
+    }
+
+    void setSeed(int number){
+        seed = ((unsigned short)(number*23729) ^ (unsigned short)(number+16786));
+        rand();
+    }
+    void setSeed(int number1,int number2){
+        seed = (((unsigned short)(number1*23729) | (unsigned short)(number2%16786)) ^ (unsigned short)(number2*number1));
+        rand();
+    }
+};
+
+
+
+/* Batched heights calculation for a row of 'count' columns
+   starting at cur_x. Expressions are kept exactly as they were in
+   per-column version to produce the same terrain. */
+class HeightsRow {
+    static const int MAX_COUNT = 64;
+    float xs[MAX_COUNT], zs[MAX_COUNT];
+    float n1[MAX_COUNT], n2[MAX_COUNT];
+    float wx[MAX_COUNT], wz[MAX_COUNT];
+    fnl_state* noise;
+
+    inline void sample(float* dst, int count) {
+        simdnoise::noise2D(noise, xs, zs, dst, count);
+    }
+public:
+    HeightsRow(fnl_state* noise) : noise(noise) {}
+
+    void calculate(int cur_x, int cur_z, int count, float* heights) {
+        if (count > MAX_COUNT) {
+            throw std::runtime_error("heights row is too long");
+        }
+        for (int i = 0; i < count; i++) heights[i] = 0;
+        
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.0125f*8-125567;
+            zs[i] = cur_z*0.0125f*8+3546;
+        }
+        sample(n1, count);
+        for (int i = 0; i < count; i++) heights[i] += n1[i];
+
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.025f*8+4647;
+            zs[i] = cur_z*0.025f*8-3436;
+        }
+        sample(n1, count);
+        for (int i = 0; i < count; i++) heights[i] += n1[i]*0.5f;
+
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.05f*8-834176;
+            zs[i] = cur_z*0.05f*8+23678;
+        }
+        sample(n1, count);
+        for (int i = 0; i < count; i++) heights[i] += n1[i]*0.25f;
+
+        // domain-warped layer
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.1f*8-23557;
+            zs[i] = cur_z*0.1f*8-6568;
+        }
+        sample(wx, count);
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.1f*8+4363;
+            zs[i] = cur_z*0.1f*8+4456;
+        }
+        sample(wz, count);
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.2f*8 + wx[i]*50;
+            zs[i] = cur_z*0.2f*8 + wz[i]*50;
+        }
+        sample(n1, count);
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.01f-834176;
+            zs[i] = cur_z*0.01f+23678;
+        }
+        sample(n2, count);
+        for (int i = 0; i < count; i++) heights[i] += n1[i] * n2[i] * 0.25;
+
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.1f*8-3465;
+            zs[i] = cur_z*0.1f*8+4534;
+        }
+        sample(n1, count);
+        for (int i = 0; i < count; i++) heights[i] += n1[i]*0.125f;
+
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i)*0.1f+1000;
+            zs[i] = cur_z*0.1f+1000;
+        }
+        sample(n1, count);
+        for (int i = 0; i < count; i++) {
+            heights[i] *= n1[i]*0.5f+0.5f;
+            heights[i] += 1.0f;
+            heights[i] *= 64.0f;
+        }
+    }
+
+    void calculateHumidity(int cur_x, int cur_z, int count, float* dst) {
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i) * 0.3 + 633;
+            zs[i] = cur_z * 0.3;
+        }
+        sample(dst, count);
+    }
+
+    void calculateSand(int cur_x, int cur_z, int count, float* dst) {
+        for (int i = 0; i < count; i++) {
+            xs[i] = (cur_x+i) * 0.1 - 633;
+            zs[i] = cur_z * 0.1 + 1000;
+        }
+        sample(dst, count);
+    }
+};
+
+static fnl_state create_noise(int seed) {
+    fnl_state noise = fnlCreateState();
+    noise.noise_type = FNL_NOISE_OPENSIMPLEX2;
+    noise.seed = seed * 60617077 % 25896307;
+    return noise;
+}
+
+/* Heights, humidity, sand and cliff maps */
+class HeightmapStage : public MapsStage {
+public:
+    uint getLayersCount() const override {
+        return MAPS_LEN;
+    }
+
+    void generate(ChunkMaps* maps, uint layers, int seed) override {
+        fnl_state noise = create_noise(seed);
+        HeightsRow row(&noise);
+        float* heightsMap = maps->getLayer(layers + (uint)MAPS::HEIGHT);
+        float* treesMap = maps->getLayer(layers + (uint)MAPS::TREE);
+        float* sandMap = maps->getLayer(layers + (uint)MAPS::SAND);
+        float* cliffMap = maps->getLayer(layers + (uint)MAPS::CLIFF);
+
+        float rowHeights[CHUNK_W];
+        float rowHumidity[CHUNK_W];
+        float rowSand[CHUNK_W];
+        for (int z = 0; z < CHUNK_D; z++){
+            int row_x = maps->x * CHUNK_W;
+            int row_z = z + maps->z * CHUNK_D;
+            row.calculate(row_x, row_z, CHUNK_W, rowHeights);
+            row.calculateHumidity(row_x, row_z, CHUNK_W, rowHumidity);
+            row.calculateSand(row_x, row_z, CHUNK_W, rowSand);
+            for (int x = 0; x < CHUNK_W; x++){
+                float height = rowHeights[x];
+                float hum = rowHumidity[x];
+                float sand = rowSand[x];
+                float cliff = pow((sand + abs(sand)) / 2, 2);
+                float w = pow(fmax(-abs(height-SEA_LEVEL)+4,0)/6,2) * cliff;
+                float h1 = -abs(height-SEA_LEVEL - 0.03);
+                float h2 = abs(height-SEA_LEVEL + 0.04);
+                float h = (h1 + h2)*100;
+                height += (h * w);
+
+                int index = z * CHUNK_W + x;
+                heightsMap[index] = height;
+                treesMap[index] = hum;
+                sandMap[index] = sand;
+                cliffMap[index] = cliff;
+            }
+        }
+    }
+};
+
+/* Terrain layers: water, stone, dirt, grass blocks, sand and bazalt */
+class SurfaceStage : public GeneratorStage {
+    uint layers;
+    blockid_t const idStone;
+    blockid_t const idDirt;
+    blockid_t const idGrassBlock;
+    blockid_t const idSand;
+    blockid_t const idWater;
+    blockid_t const idBazalt;
+public:
+    SurfaceStage(const Content* content, uint layers)
+        : GeneratorStage("surface"),
+          layers(layers),
+          idStone(content->requireBlock("base:stone")->rt.id),
+          idDirt(content->requireBlock("base:dirt")->rt.id),
+          idGrassBlock(content->requireBlock("base:grass_block")->rt.id),
+          idSand(content->requireBlock("base:sand")->rt.id),
+          idWater(content->requireBlock("base:water")->rt.id),
+          idBazalt(content->requireBlock("base:bazalt")->rt.id) {}
+
+    /* @param sandLevel,heightFraction column-dependent sand condition parts */
+    inline blockid_t getBlock(int cur_y, float height, 
+                              double sandLevel, double heightFraction) const {
+        blockid_t id = cur_y < SEA_LEVEL ? idWater : BLOCK_AIR;
+        if ((cur_y == (int)height) && (SEA_LEVEL-2 < cur_y)) {
+            id = idGrassBlock;
+        } else if (cur_y < (height - 6)){
+            id = idStone;
+        } else if (cur_y < height){
+            id = idDirt;
+        }
+        if ((sandLevel < cur_y + heightFraction) && (cur_y < height)){
+            id = idSand;
+        }
+        if (cur_y <= 2)
+            id = idBazalt;
+        return id;
+    }
+
+    void generate(voxel* voxels, const MapsArea& maps,
+                  int cx, int cz, int seed) override {
+        for (int z = 0; z < CHUNK_D; z++){
+            int cur_z = z + cz * CHUNK_D;
+            for (int x = 0; x < CHUNK_W; x++){
+                int cur_x = x + cx * CHUNK_W;
+                float height = maps.get(layers + (uint)MAPS::HEIGHT, cur_x, cur_z);
+                float sand = fmax(maps.get(layers + (uint)MAPS::SAND, cur_x, cur_z), 
+                                  maps.get(layers + (uint)MAPS::CLIFF, cur_x, cur_z));
+                // sand condition parts depending on column only
+                double sandLevel = (height -  (1.1 - 0.2 * pow(height - 54, 4)) + (5*sand));
+                double heightFraction = (height - 0.01- (int)height);
+
+                for (int cur_y = 0; cur_y < CHUNK_H; cur_y++){
+                    blockid_t id = getBlock(cur_y, height, sandLevel, heightFraction);
+                    voxels[(cur_y * CHUNK_D + z) * CHUNK_W + x].id = id;
+                    voxels[(cur_y * CHUNK_D + z) * CHUNK_W + x].states = 0;
+                }
+            }
+        }
+    }
+
+    void generateSurface(surface_column* columns, const MapsArea& maps,
+                         int cx, int cz, int seed) override {
+        for (int z = -1; z <= CHUNK_D; z++){
+            int cur_z = z + cz * CHUNK_D;
+            for (int x = -1; x <= CHUNK_W; x++){
+                int cur_x = x + cx * CHUNK_W;
+                float height = maps.get(layers + (uint)MAPS::HEIGHT, cur_x, cur_z);
+                float sand = fmax(maps.get(layers + (uint)MAPS::SAND, cur_x, cur_z), 
+                                  maps.get(layers + (uint)MAPS::CLIFF, cur_x, cur_z));
+                double sandLevel = (height -  (1.1 - 0.2 * pow(height - 54, 4)) + (5*sand));
+                double heightFraction = (height - 0.01- (int)height);
+
+                // everything above both terrain and sea level is air
+                int cur_y = std::min(std::max((int)height + 1, SEA_LEVEL - 1), CHUNK_H - 1);
+                blockid_t id = BLOCK_AIR;
+                for (; cur_y >= 0; cur_y--) {
+                    id = getBlock(cur_y, height, sandLevel, heightFraction);
+                    if (id != BLOCK_AIR) {
+                        break;
+                    }
+                }
+                columns[(z + 1) * FAR_CHUNK_W + x + 1] = {std::max(cur_y, 0), id};
+            }
+        }
+    }
+};
+
+/* Trees, grass and flowers */
+class DecorationsStage : public GeneratorStage {
+    static const int TREES_TILE = 12;
+
+    uint layers;
+    blockid_t const idWood;
+    blockid_t const idLeaves;
+    blockid_t const idGrass;
+    blockid_t const idFlower;
+public:
+    DecorationsStage(const Content* content, uint layers)
+        : GeneratorStage("decorations"),
+          layers(layers),
+          idWood(content->requireBlock("base:wood")->rt.id),
+          idLeaves(content->requireBlock("base:leaves")->rt.id),
+          idGrass(content->requireBlock("base:grass")->rt.id),
+          idFlower(content->requireBlock("base:flower")->rt.id) {}
+
+    /* tree center may be up to 8 blocks away from the column */
+    int getNeighbourRadius() const override {
+        return 1;
+    }
+
+    void generate(voxel* voxels, const MapsArea& maps,
+                  int cx, int cz, int seed) override {
+        PseudoRandom randomtree;
+        PseudoRandom randomgrass;
+        for (int z = 0; z < CHUNK_D; z++){
+            int cur_z = z + cz * CHUNK_D;
+            for (int x = 0; x < CHUNK_W; x++){
+                int cur_x = x + cx * CHUNK_W;
+                float height = maps.get(layers + (uint)MAPS::HEIGHT, cur_x, cur_z);
+                float sand = fmax(maps.get(layers + (uint)MAPS::SAND, cur_x, cur_z), 
+                                  maps.get(layers + (uint)MAPS::CLIFF, cur_x, cur_z));
+
+                generateTree(voxels, maps, &randomtree, x, z, cur_x, cur_z, height);
+
+                int cur_y = (int)(height + 1);
+                if (cur_y < 0 || cur_y >= CHUNK_H)
+                    continue;
+                voxel& vox = voxels[(cur_y * CHUNK_D + z) * CHUNK_W + x];
+                randomgrass.setSeed(cur_x,cur_z);
+                if ((vox.id == 0) && ((height > SEA_LEVEL+0.4) || (sand > 0.1)) && ((unsigned short)randomgrass.rand() > 56000)){
+                    vox.id = idGrass;
+                }
+                if ((vox.id == 0) && (height > SEA_LEVEL+0.4) && ((unsigned short)randomgrass.rand() > 65000)){
+                    vox.id = idFlower;
+                }
+                if ((height > SEA_LEVEL+1) && ((unsigned short)randomgrass.rand() > 65533)){
+                    vox.id = idWood;
+                    vox.states = BLOCK_DIR_UP;
+                }
+            }
+        }
+    }
+
+    /* Place part of the tile tree (if any) crossing the column.
+       Tree parameters depend on the column only, so they are calculated once */
+    void generateTree(voxel* voxels, const MapsArea& maps, PseudoRandom* random,
+                      int x, int z, int cur_x, int cur_z, float columnHeight) {
+        const int tileSize = TREES_TILE;
+        const int tileX = floordiv(cur_x, tileSize);
+        const int tileZ = floordiv(cur_z, tileSize);
+
+        random->setSeed(tileX*4325261+tileZ*12160951+tileSize*9431111);
+
+        int randomX = (random->rand() % (tileSize/2)) - tileSize/4;
+        int randomZ = (random->rand() % (tileSize/2)) - tileSize/4;
+
+        int centerX = tileX * tileSize + tileSize/2 + randomX;
+        int centerZ = tileZ * tileSize + tileSize/2 + randomZ;
+
+        bool gentree = (random->rand() % 10) < maps.get(layers + (uint)MAPS::TREE, centerX, centerZ) * 13;
+        if (!gentree)
+            return;
+
+        int height = (int)(maps.get(layers + (uint)MAPS::HEIGHT, centerX, centerZ));
+        if (height < SEA_LEVEL+1)
+            return;
+        int lx = cur_x - centerX;
+        int radius = random->rand() % 4 + 2;
+        int lz = cur_z - centerZ;
+
+        // trees are placed above the ground only (bazalt layer keeps tree states)
+        for (int cur_y = 0; cur_y < CHUNK_H; cur_y++){
+            if (((cur_y == (int)columnHeight) && (SEA_LEVEL-2 < cur_y)) || cur_y < columnHeight)
+                continue;
+            int ly = cur_y - height - 3 * radius;
+            blockid_t id;
+            if (lx == 0 && lz == 0 && cur_y - height < (3*radius + radius/2))
+                id = idWood;
+            else if (lx*lx+ly*ly/2+lz*lz < radius*radius)
+                id = idLeaves;
+            else
+                continue;
+            voxel& vox = voxels[(cur_y * CHUNK_D + z) * CHUNK_W + x];
+            if (cur_y > 2)
+                vox.id = id;
+            vox.states = BLOCK_DIR_UP;
+        }
+    }
+};
+
+void setup_base_generator(WorldGenerator* generator, const Content* content) {
+    uint layers = generator->addMapsStage(std::make_unique<HeightmapStage>());
+    generator->addStage(std::make_unique<SurfaceStage>(content, layers));
+    generator->addStage(std::make_unique<DecorationsStage>(content, layers));
+}
@@ -0,0 +1,10 @@
+#ifndef VOXELS_BASESTAGES_H_
+#define VOXELS_BASESTAGES_H_
+
+class Content;
+class WorldGenerator;
+
+/* Add terrain stages of the base content pack to generator */
+extern void setup_base_generator(WorldGenerator* generator, const Content* content);
+
+#endif // VOXELS_BASESTAGES_H_
@@ -26,6 +26,10 @@ public:
 	Lightmap* lightmap;
 	int flags = 0;
 	int surrounding = 0;
+	/* Layers range [modifiedBottom, modifiedTop) containing voxels
+	   changed since the mesh was built (empty if not modified) */
+	int modifiedBottom = CHUNK_H;
+	int modifiedTop = 0;
 
 	Chunk(int x, int z);
 	~Chunk();
@@ -58,7 +62,18 @@ public:
 
 	inline void setUnsaved(bool newState) {setFlags(ChunkFlag::UNSAVED, newState);}
 
-	inline void setModified(bool newState) {setFlags(ChunkFlag::MODIFIED, newState);}
+	inline void setModified(bool newState) {
+		setFlags(ChunkFlag::MODIFIED, newState);
+		modifiedBottom = newState ? 0 : CHUNK_H;
+		modifiedTop = newState ? CHUNK_H : 0;
+	}
+
+	/* Mark layers range [bottom, top) modified */
+	inline void setModifiedLayers(int bottom, int top) {
+		flags |= ChunkFlag::MODIFIED;
+		if (bottom < modifiedBottom) modifiedBottom = bottom;
+		if (top > modifiedTop) modifiedTop = top;
+	}
 
 	inline void setLoaded(bool newState) {setFlags(ChunkFlag::LOADED, newState);}
 
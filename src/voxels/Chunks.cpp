@@ -164,21 +164,26 @@ void Chunks::set(int x, int y, int z, int id, uint8_t states){
 	chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx].id = id;
 	chunk->voxels[(y * CHUNK_D + lz) * CHUNK_W + lx].states = states;
 	chunk->setUnsaved(true);
-	chunk->setModified(true);
+	markModified(chunk, lx, y, lz);
 
 	if (y < chunk->bottom) chunk->bottom = y;
 	else if (y + 1 > chunk->top) chunk->top = y + 1;
 	else if (id == 0) chunk->updateHeights();
+}
 
-	if (lx == 0 && (chunk = getChunk(cx+ox-1, cz+oz)))
-		chunk->setModified(true);
-	if (lz == 0 && (chunk = getChunk(cx+ox, cz+oz-1))) 
-		chunk->setModified(true);
-
-	if (lx == CHUNK_W-1 && (chunk = getChunk(cx+ox+1, cz+oz))) 
-		chunk->setModified(true);
-	if (lz == CHUNK_D-1 && (chunk = getChunk(cx+ox, cz+oz+1))) 
-		chunk->setModified(true);
+void Chunks::markModified(Chunk* chunk, int lx, int y, int lz){
+	chunk->setModifiedLayers(y, y+1);
+	const int dx = (lx == CHUNK_W-1) - (lx == 0);
+	const int dz = (lz == CHUNK_D-1) - (lz == 0);
+	if (dx == 0 && dz == 0)
+		return;
+	Chunk* other;
+	if (dx && (other = getChunk(chunk->x+dx, chunk->z)))
+		other->setModifiedLayers(y, y+1);
+	if (dz && (other = getChunk(chunk->x, chunk->z+dz)))
+		other->setModifiedLayers(y, y+1);
+	if (dx && dz && (other = getChunk(chunk->x+dx, chunk->z+dz)))
+		other->setModifiedLayers(y, y+1);
 }
 
 voxel* Chunks::rayCast(glm::vec3 start, 
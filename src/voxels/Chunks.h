@@ -45,6 +45,11 @@ public:
 	ubyte getLight(int x, int y, int z, int channel);
 	void set(int x, int y, int z, int id, uint8_t states);
 
+	/* Mark chunk voxel (local coordinates) changed, so meshes depending
+	   on it will be rebuilt: chunk layer and neighbour chunks
+	   (including diagonal ones) if the voxel is on the border */
+	void markModified(Chunk* chunk, int lx, int y, int lz);
+
 	voxel* rayCast(glm::vec3 start, 
 				   glm::vec3 dir, 
 				   float maxLength, 
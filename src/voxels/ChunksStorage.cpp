@@ -1,6 +1,7 @@
 #include "ChunksStorage.h"
 
 #include <assert.h>
+#include <algorithm>
 #include <iostream>
 
 #include "VoxelsVolume.h"
@@ -14,7 +15,12 @@
 #include "../lighting/Lightmap.h"
 #include "../typedefs.h"
 
-ChunksStorage::ChunksStorage(Level* level) : level(level) {
+ChunksStorage::ChunksStorage(Level* level)
+	: level(level), content(level->content) {
+}
+
+ChunksStorage::ChunksStorage(const Content* content)
+	: level(nullptr), content(content) {
 }
 
 void ChunksStorage::store(std::shared_ptr<Chunk> chunk) {
@@ -49,6 +55,7 @@ static void verifyLoadedChunk(ContentIndices* indices, Chunk* chunk) {
 }
 
 std::shared_ptr<Chunk> ChunksStorage::create(int x, int z) {
+	assert(level != nullptr);
 	World* world = level->getWorld();
     WorldFiles* wfile = world->wfile;
 
@@ -58,7 +65,7 @@ std::shared_ptr<Chunk> ChunksStorage::create(int x, int z) {
 	if (data) {
 		chunk->decode(data.get());
 		chunk->setLoaded(true);
-        verifyLoadedChunk(level->content->getIndices(), chunk.get());
+        verifyLoadedChunk(content->getIndices(), chunk.get());
 	}
 
 	light_t* lights = wfile->getLights(chunk->x, chunk->z);
@@ -69,10 +76,11 @@ std::shared_ptr<Chunk> ChunksStorage::create(int x, int z) {
 	return chunk;
 }
 
-// some magic code
-void ChunksStorage::getVoxels(VoxelsVolume* volume, bool backlight) const {
-	const Content* content = level->content;
-	auto indices = content->getIndices();
+void ChunksStorage::getVoxels(VoxelsVolume* volume) const {
+	getVoxels(volume, 0, volume->getH());
+}
+
+void ChunksStorage::getVoxels(VoxelsVolume* volume, int bottom, int top) const {
 	voxel* voxels = volume->getVoxels();
 	light_t* lights = volume->getLights();
 	int x = volume->getX();
@@ -80,67 +88,44 @@ void ChunksStorage::getVoxels(VoxelsVolume* volume, bool backlight) const {
 	int z = volume->getZ();
 
 	int w = volume->getW();
-	int h = volume->getH();
 	int d = volume->getD();
 
 	int scx = floordiv(x, CHUNK_W);
 	int scz = floordiv(z, CHUNK_D);
+	int ecx = floordiv(x + w - 1, CHUNK_W);
+	int ecz = floordiv(z + d - 1, CHUNK_D);
+
+	// each chunk is found once, its voxels are copied by rows
+	for (int cz = scz; cz <= ecz; cz++) {
+		int z1 = max(z, cz * CHUNK_D);
+		int z2 = min(z + d, (cz + 1) * CHUNK_D);
+		for (int cx = scx; cx <= ecx; cx++) {
+			int x1 = max(x, cx * CHUNK_W);
+			int x2 = min(x + w, (cx + 1) * CHUNK_W);
+			int length = x2 - x1;
 
-	int ecx = floordiv(x + w, CHUNK_W);
-	int ecz = floordiv(z + d, CHUNK_D);
-
-	int cw = ecx - scx + 1;
-	int ch = ecz - scz + 1;
-
-	// cw*ch chunks will be scanned
-	for (int cz = scz; cz < scz + ch; cz++) {
-		for (int cx = scx; cx < scx + cw; cx++) {
 			auto found = chunksMap.find(glm::ivec2(cx, cz));
 			if (found == chunksMap.end()) {
 				// no chunk loaded -> filling with BLOCK_VOID
-				for (int ly = y; ly < y + h; ly++) {
-					for (int lz = max(z, cz * CHUNK_D);
-						lz < min(z + d, (cz + 1) * CHUNK_D);
-						lz++) {
-						for (int lx = max(x, cx * CHUNK_W);
-							lx < min(x + w, (cx + 1) * CHUNK_W);
-							lx++) {
-							uint idx = vox_index(lx - x, ly - y, lz - z, w, d);
-							voxels[idx].id = BLOCK_VOID;
-							lights[idx] = 0;
-						}
+				for (int ly = y + bottom; ly < y + top; ly++) {
+					for (int lz = z1; lz < z2; lz++) {
+						uint vidx = vox_index(x1 - x, ly - y, lz - z, w, d);
+						std::fill_n(voxels + vidx, length, voxel {BLOCK_VOID, 0});
+						std::fill_n(lights + vidx, length, 0);
 					}
 				}
-			} else {
-				auto& chunk = found->second;
-				const voxel* cvoxels = chunk->voxels;
-				const light_t* clights = chunk->lightmap->getLights();
-				for (int ly = y; ly < y + h; ly++) {
-					for (int lz = max(z, cz * CHUNK_D);
-						lz < min(z + d, (cz + 1) * CHUNK_D);
-						lz++) {
-						for (int lx = max(x, cx * CHUNK_W);
-							lx < min(x + w, (cx + 1) * CHUNK_W);
-							lx++) {
-							uint vidx = vox_index(lx - x, ly - y, lz - z, w, d);
-							uint cidx = vox_index(lx - cx * CHUNK_W, ly, 
-										lz - cz * CHUNK_D, CHUNK_W, CHUNK_D);
-							voxels[vidx] = cvoxels[cidx];
-							light_t light = clights[cidx];
-							if (backlight) {
-								const Block* block = indices->getBlockDef(voxels[vidx].id);
-								if (block->lightPassing) {
-									light = Lightmap::combine(
-										min(15, Lightmap::extract(light, 0)+1),
-										min(15, Lightmap::extract(light, 1)+1),
-										min(15, Lightmap::extract(light, 2)+1),
-										min(15, Lightmap::extract(light, 3))
-									);
-								}
-							}
-							lights[vidx] = light;
-						}
-					}
+				continue;
+			}
+			const Chunk* chunk = found->second.get();
+			const voxel* cvoxels = chunk->voxels;
+			const light_t* clights = chunk->lightmap->getLights();
+			for (int ly = y + bottom; ly < y + top; ly++) {
+				for (int lz = z1; lz < z2; lz++) {
+					uint vidx = vox_index(x1 - x, ly - y, lz - z, w, d);
+					uint cidx = vox_index(x1 - cx * CHUNK_W, ly, 
+										  lz - cz * CHUNK_D, CHUNK_W, CHUNK_D);
+					std::copy_n(cvoxels + cidx, length, voxels + vidx);
+					std::copy_n(clights + cidx, length, lights + vidx);
 				}
 			}
 		}
@@ -11,19 +11,29 @@
 
 class Chunk;
 class Level;
+class Content;
 class VoxelsVolume;
 
 class ChunksStorage {
 	Level* level;
+	const Content* content;
 	std::unordered_map<glm::ivec2, std::shared_ptr<Chunk>> chunksMap;
 public:
 	ChunksStorage(Level* level);
+	/* Storage not bound to a level: chunks are added with store() only,
+	   create() is not available (used by headless benchmarks) */
+	ChunksStorage(const Content* content);
 	~ChunksStorage() = default;
 
 	std::shared_ptr<Chunk> get(int x, int z) const;
 	void store(std::shared_ptr<Chunk> chunk);
 	void remove(int x, int y);
-	void getVoxels(VoxelsVolume* volume, bool backlight=false) const;
+	/* Copy voxels and lights to the volume, positions without loaded
+	   chunks are filled with BLOCK_VOID. Lights are copied as is, blocks
+	   backlight is applied by BlocksRenderer when lights are sampled */
+	void getVoxels(VoxelsVolume* volume) const;
+	/* Copy only volume layers bottom..top-1, other layers are not changed */
+	void getVoxels(VoxelsVolume* volume, int bottom, int top) const;
 	std::shared_ptr<Chunk> create(int x, int z);
 
 	light_t getLight(int x, int y, int z, ubyte channel) const;
@@ -0,0 +1,52 @@
+#include "FarTerrain.h"
+
+#include <algorithm>
+
+FarChunk::FarChunk(int x, int z)
+    : x(x), z(z), columns(new surface_column[FAR_CHUNK_W * FAR_CHUNK_D]) {
+}
+
+void FarChunk::updateHeights() {
+    bottom = CHUNK_H;
+    top = 0;
+    for (int i = 0; i < FAR_CHUNK_W * FAR_CHUNK_D; i++) {
+        bottom = std::min(bottom, columns[i].height);
+        top = std::max(top, columns[i].height + 1);
+    }
+}
+
+std::shared_ptr<FarChunk> FarTerrain::get(int x, int z) const {
+    auto found = chunksMap.find(glm::ivec2(x, z));
+    if (found == chunksMap.end()) {
+        return nullptr;
+    }
+    return found->second;
+}
+
+void FarTerrain::store(std::shared_ptr<FarChunk> chunk) {
+    chunksMap[glm::ivec2(chunk->x, chunk->z)] = chunk;
+}
+
+void FarTerrain::remove(int x, int z) {
+    if (chunksMap.erase(glm::ivec2(x, z))) {
+        version++;
+    }
+}
+
+void FarTerrain::clear() {
+    chunksMap.clear();
+    version++;
+}
+
+void FarTerrain::removeOutside(int cx, int cz, int radius) {
+    for (auto it = chunksMap.begin(); it != chunksMap.end();) {
+        int dx = it->first.x - cx;
+        int dz = it->first.y - cz;
+        if (dx * dx + dz * dz > radius * radius) {
+            it = chunksMap.erase(it);
+            version++;
+        } else {
+            it++;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef VOXELS_FARTERRAIN_H_
+#define VOXELS_FARTERRAIN_H_
+
+#include <memory>
+#include <unordered_map>
+#include "../typedefs.h"
+#include "../constants.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+/* Columns of far chunk include 1-block border of neighbour chunks,
+   so far chunk mesh may be built without neighbours */
+const int FAR_CHUNK_W = CHUNK_W + 2;
+const int FAR_CHUNK_D = CHUNK_D + 2;
+
+/* Topmost non-air block of a column */
+struct surface_column {
+    int height;
+    blockid_t id;
+};
+
+/* Reduced detail (2.5D) representation of a chunk drawn where
+   the full chunk is not loaded or not lighted yet */
+class FarChunk {
+public:
+    const int x, z;
+    std::unique_ptr<surface_column[]> columns;
+    /* min and max of columns heights */
+    int bottom = 0, top = 0;
+
+    FarChunk(int x, int z);
+
+    /* @param lx,lz local coordinates in range [-1, CHUNK_W] and [-1, CHUNK_D] */
+    inline const surface_column& get(int lx, int lz) const {
+        return columns[(lz + 1) * FAR_CHUNK_W + lx + 1];
+    }
+
+    void updateHeights();
+};
+
+class FarTerrain {
+    std::unordered_map<glm::ivec2, std::shared_ptr<FarChunk>> chunksMap;
+    /* incremented when any chunk removed */
+    uint version = 0;
+public:
+    std::shared_ptr<FarChunk> get(int x, int z) const;
+    void store(std::shared_ptr<FarChunk> chunk);
+    void remove(int x, int z);
+    void clear();
+
+    /* Remove chunks out of circle radius (chunk is unit) */
+    void removeOutside(int cx, int cz, int radius);
+
+    const std::unordered_map<glm::ivec2, std::shared_ptr<FarChunk>>& getChunks() const {
+        return chunksMap;
+    }
+
+    uint getVersion() const {
+        return version;
+    }
+};
+
+#endif // VOXELS_FARTERRAIN_H_
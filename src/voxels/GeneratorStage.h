@@ -0,0 +1,105 @@
+#ifndef VOXELS_GENERATORSTAGE_H_
+#define VOXELS_GENERATORSTAGE_H_
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+#include "../typedefs.h"
+#include "../constants.h"
+#include "../maths/voxmaths.h"
+
+struct voxel;
+struct surface_column;
+
+/* Cacheable 2D data of a chunk column: 'layers' maps of CHUNK_W*CHUNK_D values */
+class ChunkMaps {
+    std::unique_ptr<float[]> data;
+public:
+    /* chunk coordinates */
+    const int x, z;
+
+    ChunkMaps(int x, int z, uint layers)
+        : data(new float[layers * CHUNK_W * CHUNK_D]), x(x), z(z) {
+    }
+
+    inline float* getLayer(uint layer) {
+        return data.get() + layer * CHUNK_W * CHUNK_D;
+    }
+
+    inline float get(uint layer, int lx, int lz) const {
+        return data[(layer * CHUNK_D + lz) * CHUNK_W + lx];
+    }
+};
+
+/* Maps of chunks in square radius around the generated chunk,
+   accessed with global block coordinates */
+class MapsArea {
+    int cx, cz;
+    int radius;
+    int size;
+    std::vector<std::shared_ptr<ChunkMaps>> chunks;
+public:
+    MapsArea(int cx, int cz, int radius)
+        : cx(cx), cz(cz), radius(radius), size(radius*2+1), chunks(size*size) {
+    }
+
+    /* @param x,z chunk coordinates relative to the area center */
+    inline void set(int x, int z, std::shared_ptr<ChunkMaps> maps) {
+        chunks[(z + radius) * size + x + radius] = maps;
+    }
+
+    inline float get(uint layer, int x, int z) const {
+        int mx = floordiv(x, CHUNK_W);
+        int mz = floordiv(z, CHUNK_D);
+        int ax = mx - cx + radius;
+        int az = mz - cz + radius;
+        if (ax < 0 || az < 0 || ax >= size || az >= size) {
+            throw std::runtime_error("out of generator maps area");
+        }
+        return chunks[az * size + ax]->get(layer, x - mx * CHUNK_W, z - mz * CHUNK_D);
+    }
+};
+
+/* Stage producing 2D maps (heights, biomes etc.) of a chunk column.
+   Maps are calculated once and cached, so neighbour chunks share them */
+class MapsStage {
+public:
+    virtual ~MapsStage() = default;
+
+    virtual uint getLayersCount() const = 0;
+
+    /* @param layers first of stage layers in maps */
+    virtual void generate(ChunkMaps* maps, uint layers, int seed) = 0;
+};
+
+/* Stage filling or modifying chunk voxels, stages are applied
+   in order they were added to generator */
+class GeneratorStage {
+    std::string name;
+public:
+    GeneratorStage(std::string name) : name(name) {}
+    virtual ~GeneratorStage() = default;
+
+    /* @return radius (in chunks) of neighbour maps required by stage */
+    virtual int getNeighbourRadius() const {
+        return 0;
+    }
+
+    virtual void generate(voxel* voxels, const MapsArea& maps,
+                          int cx, int cz, int seed) = 0;
+
+    /* Fill or modify columns of reduced detail terrain (see FarChunk),
+       stages not affecting the surface shape may leave it as is
+       @param columns FAR_CHUNK_W*FAR_CHUNK_D columns including border */
+    virtual void generateSurface(surface_column* columns, const MapsArea& maps,
+                                 int cx, int cz, int seed) {
+    }
+
+    const std::string& getName() const {
+        return name;
+    }
+};
+
+#endif // VOXELS_GENERATORSTAGE_H_
@@ -1,25 +1,68 @@
 #ifndef VOXELS_WORLDGENERATOR_H_
 #define VOXELS_WORLDGENERATOR_H_
 
+#include <mutex>
+#include <queue>
+#include <memory>
+#include <vector>
+#include <unordered_map>
 #include "../typedefs.h"
 
-class voxel;
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+struct voxel;
+struct surface_column;
 class Content;
+class ChunkMaps;
+class MapsStage;
+class GeneratorStage;
+
+/* Accumulated durations of generation (microseconds) */
+struct GeneratorTimings {
+	/* maps calculation (cache misses only) */
+	int64_t maps = 0;
+	/* indices are same as in WorldGenerator::getStages() */
+	std::vector<int64_t> stages;
+};
 
+/* Multi-stage chunks generator.
+   Maps stages produce cacheable 2D maps of chunk columns,
+   generator stages fill voxels reading maps of chunks in their
+   neighbour radius. Generator is thread-safe. */
 class WorldGenerator {
-	blockid_t const idStone;
-	blockid_t const idDirt;
-	blockid_t const idGrassBlock;
-	blockid_t const idSand;
-	blockid_t const idWater;
-	blockid_t const idWood;
-	blockid_t const idLeaves;
-	blockid_t const idGrass;
-	blockid_t const idFlower;
-	blockid_t const idBazalt;
+	std::vector<std::unique_ptr<MapsStage>> mapsStages;
+	std::vector<std::unique_ptr<GeneratorStage>> stages;
+	uint mapsLayers = 0;
+	int neighbourRadius = 0;
+
+	std::mutex cacheMutex;
+	std::unordered_map<glm::ivec3, std::shared_ptr<ChunkMaps>> mapsCache;
+	std::queue<glm::ivec3> cacheOrder;
+
+	std::shared_ptr<ChunkMaps> getMaps(int cx, int cz, int seed,
+									   GeneratorTimings* timings);
 public:
+	static const size_t MAPS_CACHE_CAPACITY = 2048;
+
+	/* Creates generator with stages of the base content pack */
 	WorldGenerator(const Content* content);
-	void generate(voxel* voxels, int x, int z, int seed);
+	~WorldGenerator();
+
+	/* @return index of the first stage layer in maps */
+	uint addMapsStage(std::unique_ptr<MapsStage> stage);
+	void addStage(std::unique_ptr<GeneratorStage> stage);
+
+	/* @param timings durations will be added to (nullable) */
+	void generate(voxel* voxels, int x, int z, int seed,
+				  GeneratorTimings* timings=nullptr);
+
+	/* Generate reduced detail terrain: surface block of each column
+	   without full voxels generation (trees are not included)
+	   @param columns FAR_CHUNK_W*FAR_CHUNK_D columns (see FarChunk) */
+	void generateSurface(surface_column* columns, int x, int z, int seed);
+
+	const std::vector<std::unique_ptr<GeneratorStage>>& getStages() const;
 };
 
 #endif /* VOXELS_WORLDGENERATOR_H_ */
@@ -6,6 +6,7 @@
 #include "../voxels/Chunk.h"
 #include "../voxels/Chunks.h"
 #include "../voxels/ChunksStorage.h"
+#include "../voxels/FarTerrain.h"
 #include "../physics/Hitbox.h"
 #include "../physics/PhysicsSolver.h"
 #include "../objects/Player.h"
@@ -15,6 +16,7 @@ Level::Level(World* world, const Content* content, Player* player, EngineSetting
 	    content(content),
 		player(player),
 		chunksStorage(new ChunksStorage(this)),
+		farTerrain(new FarTerrain()),
 		events(new LevelEvents()) ,
 		settings(settings) {
     physics = new PhysicsSolver(glm::vec3(0, -22.6f, 0));
@@ -37,6 +39,7 @@ Level::~Level(){
 	delete player;
 	delete lighting;
 	delete chunksStorage;
+	delete farTerrain;
 }
 
 void Level::update() {
@@ -14,6 +14,7 @@ class LevelEvents;
 class Lighting;
 class PhysicsSolver;
 class ChunksStorage;
+class FarTerrain;
 
 class Level {
 public:
@@ -22,6 +23,7 @@ public:
 	Player* player;
 	Chunks* chunks;
 	ChunksStorage* chunksStorage;
+	FarTerrain* farTerrain;
 
 	PhysicsSolver* physics;
 	Lighting* lighting;